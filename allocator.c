@@ -0,0 +1,126 @@
+/*
+ * allocator.c - The registry of malloc packages linked into the driver
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "mm.h"
+#include "memlib.h"
+#include "config.h"
+#include "allocator.h"
+
+/*
+ * mm.c: resetting memlib's brk pointer throws away the old heap. Each
+ * variant selects its policies before mm_init.
+ */
+static int mm_reset_with(int fit, int bibop, int split)
+{
+    mem_reset_brk();
+    mm_set_fit(fit);
+    mm_set_bibop(bibop);
+    mm_set_split(split);
+    return mm_init();
+}
+
+static int mm_reset(void)
+{
+    return mm_reset_with(MM_FIT_SIZE, 0, MM_SPLIT_FRONT);
+}
+
+static allocator_t mm_allocator = {
+    "mm", "The malloc package in mm.c", 1, MM_THREADSAFE,
+    mm_reset, mm_malloc, mm_free, mm_realloc, mm_heapstats,
+    mm_blockwaste, mm_snapshot, mm_restore
+};
+
+/*
+ * mm.c with its free lists in address order
+ */
+static int mm_ao_reset(void)
+{
+    return mm_reset_with(MM_FIT_ADDRESS, 0, MM_SPLIT_FRONT);
+}
+
+static allocator_t mm_ao_allocator = {
+    "mm-ao", "mm.c, lowest address first fit", 1, MM_THREADSAFE,
+    mm_ao_reset, mm_malloc, mm_free, mm_realloc, mm_heapstats,
+    mm_blockwaste, mm_snapshot, mm_restore
+};
+
+/*
+ * mm.c with small requests served from size-segregated runs
+ */
+static int mm_bibop_reset(void)
+{
+    return mm_reset_with(MM_FIT_SIZE, 1, MM_SPLIT_FRONT);
+}
+
+static allocator_t mm_bibop_allocator = {
+    "mm-bibop", "mm.c, small objects in BiBoP runs", 1, MM_THREADSAFE,
+    mm_bibop_reset, mm_malloc, mm_free, mm_realloc, mm_heapstats,
+    mm_blockwaste, mm_snapshot, mm_restore
+};
+
+/*
+ * mm.c with large requests taken from the back of the block they split
+ */
+static int mm_split_reset(void)
+{
+    return mm_reset_with(MM_FIT_SIZE, 0, MM_SPLIT_SIZE);
+}
+
+static allocator_t mm_split_allocator = {
+    "mm-split", "mm.c, large blocks split off the back", 1, MM_THREADSAFE,
+    mm_split_reset, mm_malloc, mm_free, mm_realloc, mm_heapstats,
+    mm_blockwaste, mm_snapshot, mm_restore
+};
+
+/*
+ * mm.c with each block placed next to the neighbour closer in size
+ */
+static int mm_nbr_reset(void)
+{
+    return mm_reset_with(MM_FIT_SIZE, 0, MM_SPLIT_NEIGHBOUR);
+}
+
+static allocator_t mm_nbr_allocator = {
+    "mm-nbr", "mm.c, split next to the closer-sized neighbour", 1, 
+    MM_THREADSAFE, mm_nbr_reset, mm_malloc, mm_free, mm_realloc, 
+    mm_heapstats, mm_blockwaste, mm_snapshot, mm_restore
+};
+
+/*
+ * libc: the system allocator has no heap of ours to reset
+ */
+static int libc_reset(void)
+{
+    return 0;
+}
+
+static allocator_t libc_allocator = {
+    "libc", "The system's malloc package", 0, 1,
+    libc_reset, malloc, free, realloc, NULL, NULL, NULL, NULL
+};
+
+allocator_t *allocators[] = {
+    &mm_allocator,
+    &mm_ao_allocator,
+    &mm_bibop_allocator,
+    &mm_split_allocator,
+    &mm_nbr_allocator,
+    &libc_allocator,
+    NULL
+};
+
+/*
+ * find_allocator - Return the allocator called name, or NULL
+ */
+allocator_t *find_allocator(char *name)
+{
+    int i;
+
+    for (i = 0; allocators[i] != NULL; i++)
+	if (!strcmp(allocators[i]->name, name))
+	    return allocators[i];
+    return NULL;
+}
@@ -0,0 +1,32 @@
+/*
+ * allocator.h - A common interface to the malloc packages that the
+ *     driver can evaluate, and the registry that names them.
+ *
+ * To add a package (e.g., a variant of mm.c with a different fit
+ * policy, built under its own function names), give it an allocator_t
+ * and list it in allocators[] in allocator.c. It can then be selected
+ * with the driver's -m option.
+ *
+ * Include mm.h (for heapstats_t and blockwaste_t) before this file.
+ */
+
+typedef struct {
+    char *name;                       /* what -m calls it */
+    char *description;                /* one line for mdriver -h */
+    int uses_memlib;                  /* does it allocate from memlib's heap? */
+    int threadsafe;                   /* may it be called from several threads? */
+    int (*init)(void);                /* start over with an empty heap */
+    void *(*malloc)(size_t size);
+    void (*free)(void *ptr);
+    void *(*realloc)(void *ptr, size_t size);
+    void (*heapstats)(heapstats_t *stats); /* free space, or NULL if unknown */
+    void (*blockwaste)(void *ptr, size_t size, blockwaste_t *waste); /* or NULL */
+    void (*snapshot)(void);           /* save the heap just after init... */
+    int (*restore)(void);             /* ... and go back to it, or NULL */
+} allocator_t;
+
+/* The registry: every allocator linked into the driver, NULL-terminated */
+extern allocator_t *allocators[];
+
+/* Return the allocator called name, or NULL if there is none */
+allocator_t *find_allocator(char *name);
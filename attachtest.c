@@ -0,0 +1,203 @@
+/*
+ * attachtest.c - Check that persistent heaps survive mm_detach and
+ *     mm_attach
+ *
+ *     unix> make attachtest
+ *
+ * Builds a heap in one process and checks it from another, then checks
+ * that mm_attach turns away a heap in use, a heap that was never
+ * detached and a file that is not a heap. It exits with status 1, after
+ * saying which check failed, if anything goes wrong.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "mm.h"
+#include "memlib.h"
+
+#define HEAP_FILE  "attachtest.heap"
+#define OTHER_FILE "attachtest.other"
+#define NBLOCKS    1000
+
+/*
+ * The root: the blocks, as offsets from the root itself, since the file
+ * need not be mapped at the same address next time
+ */
+typedef struct {
+    size_t heapsize;
+    unsigned off[NBLOCKS];
+    unsigned len[NBLOCKS];
+} root_t;
+
+static void fail(char *what, int i)
+{
+    fprintf(stderr, "attachtest: %s (%d)\n", what, i);
+    exit(1);
+}
+
+static void fill(unsigned char *p, unsigned n, int seed)
+{
+    unsigned i;
+
+    for (i = 0; i < n; i++)
+	p[i] = (unsigned char)(i * 7 + seed);
+}
+
+static void check(unsigned char *p, unsigned n, int seed)
+{
+    unsigned i;
+
+    for (i = 0; i < n; i++)
+	if (p[i] != (unsigned char)(i * 7 + seed))
+	    fail("block changed", seed);
+}
+
+/* The size of block i, and whether the first process frees it */
+#define SIZE(i)  (1 + (i) * 37 % 2000)
+#define HOLE(i)  ((i) % 3 == 1)
+
+/*
+ * in_child - Run step in a new process, failing if it fails
+ */
+static void in_child(void (*step)(void), char *what)
+{
+    pid_t pid;
+    int status;
+
+    if ((pid = fork()) < 0)
+	fail("fork failed", errno);
+    if (pid == 0) {
+	step();
+	exit(0);
+    }
+    if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+	WEXITSTATUS(status) != 0)
+	fail(what, 0);
+}
+
+/*
+ * create - Make a new heap with holes in it, and detach it
+ */
+static void create(void)
+{
+    root_t *root;
+    unsigned char *p;
+    int i;
+
+    if (mm_attach(HEAP_FILE) < 0)
+	fail("mm_attach of a new file failed", errno);
+    if (mm_root() != NULL)
+	fail("new heap has a root", 0);
+    if ((root = mm_malloc(sizeof(root_t))) == NULL)
+	fail("mm_malloc failed", 0);
+    for (i = 0; i < NBLOCKS; i++) {
+	if ((p = mm_malloc(SIZE(i))) == NULL)
+	    fail("mm_malloc failed", i);
+	fill(p, SIZE(i), i);
+	root->off[i] = p - (unsigned char *)root;
+	root->len[i] = SIZE(i);
+    }
+    for (i = 0; i < NBLOCKS; i++)
+	if (HOLE(i)) {
+	    mm_free((unsigned char *)root + root->off[i]);
+	    root->len[i] = 0;
+	}
+    root->heapsize = mem_heapsize();
+    mm_set_root(root);
+    mm_detach();
+}
+
+/*
+ * reopen - Find the blocks again, and fill the holes from the free
+ *     lists without growing the heap
+ */
+static void reopen(void)
+{
+    root_t *root;
+    unsigned char *p;
+    int i;
+
+    if (mm_attach(HEAP_FILE) < 0)
+	fail("mm_attach of a detached heap failed", errno);
+    if ((root = mm_root()) == NULL)
+	fail("root lost", 0);
+    if (mem_heapsize() != root->heapsize)
+	fail("heap size changed", (int)mem_heapsize());
+    for (i = 0; i < NBLOCKS; i++)
+	if (root->len[i] != 0)
+	    check((unsigned char *)root + root->off[i], root->len[i], i);
+
+    for (i = 0; i < NBLOCKS; i++)
+	if (HOLE(i)) {
+	    if ((p = mm_malloc(SIZE(i))) == NULL)
+		fail("mm_malloc failed", i);
+	    fill(p, SIZE(i), i);
+	    root->off[i] = p - (unsigned char *)root;
+	    root->len[i] = SIZE(i);
+	}
+    if (mem_heapsize() != root->heapsize)
+	fail("holes not reused", (int)mem_heapsize());
+    for (i = 0; i < NBLOCKS; i++)
+	check((unsigned char *)root + root->off[i], root->len[i], i);
+    mm_detach();
+}
+
+/*
+ * busy - Try to attach the heap the parent has attached. The file lock
+ *     has to stop memlib before mm.c even looks at the heap.
+ */
+static void busy(void)
+{
+    if (mem_init_file(HEAP_FILE) >= 0 || errno != EBUSY)
+	fail("heap file not locked", errno);
+    if (mm_attach(HEAP_FILE) == 0 || errno != EBUSY)
+	fail("heap attached twice", errno);
+}
+
+/*
+ * crash - Attach the heap and die without detaching it
+ */
+static void crash(void)
+{
+    if (mm_attach(HEAP_FILE) < 0)
+	fail("mm_attach of a detached heap failed", errno);
+    mm_malloc(100);
+    exit(0);
+}
+
+int main(void)
+{
+    FILE *fp;
+
+    unlink(HEAP_FILE);
+    in_child(create, "create");
+    in_child(reopen, "reopen");
+
+    /* A heap in use by another process */
+    if (mm_attach(HEAP_FILE) < 0)
+	fail("mm_attach of a detached heap failed", errno);
+    in_child(busy, "busy");
+    mm_detach();
+
+    /* A heap that was never detached */
+    in_child(crash, "crash");
+    if (mm_attach(HEAP_FILE) == 0 || errno != EBUSY)
+	fail("heap that was never detached attached", errno);
+
+    /* A file that is not a heap */
+    if ((fp = fopen(OTHER_FILE, "w")) == NULL)
+	fail("fopen failed", errno);
+    fputs("not a heap\n", fp);
+    fclose(fp);
+    if (mm_attach(OTHER_FILE) == 0 || errno != EINVAL)
+	fail("foreign file attached", errno);
+
+    unlink(HEAP_FILE);
+    unlink(OTHER_FILE);
+    printf("attachtest: OK\n");
+    return 0;
+}
@@ -1,6 +1,6 @@
 /* 
- * clock.c - Routines for using the cycle counters on x86, 
- *           Alpha, and Sparc boxes.
+ * clock.c - Routines for using the cycle counters on x86, x86-64,
+ *           Alpha, and Sparc boxes, and the POSIX monotonic clock.
  * 
  * Copyright (c) 2002, R. Bryant and D. O'Hallaron, All rights reserved.
  * May not be used, modified, or copied without permission.
@@ -10,23 +10,26 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <sys/times.h>
+#include <time.h>
+#if defined(__i386__) || defined(__x86_64__)
+#include <cpuid.h>
+#endif
 #include "clock.h"
 
 
 /******************************************************* 
  * Machine dependent functions 
  *
- * Note: the constants __i386__ and  __alpha
+ * Note: the constants __i386__, __x86_64__ and __alpha
  * are set by GCC when it calls the C preprocessor
  * You can verify this for yourself using gcc -v.
  *******************************************************/
 
-#if defined(__i386__)  
+#if defined(__i386__) || defined(__x86_64__)
 /*******************************************************
- * Pentium versions of start_counter() and get_counter()
+ * x86 versions of start_counter() and get_counter()
  *******************************************************/
 
-
 /* $begin x86cyclecounter */
 /* Initialize the cycle counter */
 static unsigned cyc_hi = 0;
@@ -34,13 +37,25 @@ static unsigned cyc_lo = 0;
 
 
 /* Set *hi and *lo to the high and low order bits  of the cycle counter.  
-   Implementation requires assembly code to use the rdtsc instruction. */
+   Implementation requires assembly code to use the rdtscp instruction,
+   which unlike rdtsc waits for the code being timed to finish. */
 void access_counter(unsigned *hi, unsigned *lo)
 {
-    asm("rdtsc; movl %%edx,%0; movl %%eax,%1"   /* Read cycle counter */
+    asm volatile("rdtscp; movl %%edx,%0; movl %%eax,%1" /* Read counter */
 	: "=r" (*hi), "=r" (*lo)                /* and move results to */
 	: /* No input */                        /* the two outputs */
-	: "%edx", "%eax");
+	: "%edx", "%eax", "%ecx");
+}
+
+/* Is the cycle counter invariant, i.e., does it tick at a constant
+   rate regardless of frequency scaling and sleep states? */
+int tsc_invariant()
+{
+    unsigned eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+	return 0;
+    return (edx >> 8) & 1; /* "Invariant TSC" bit */
 }
 
 /* Record the current value of the cycle counter. */
@@ -133,6 +148,11 @@ double get_counter()
     return result;
 }
 
+int tsc_invariant()
+{
+    return 0;
+}
+
 #else
 
 /****************************************************************
@@ -158,6 +178,11 @@ double get_counter()
     printf("Please choose another timing package in config.h.\n");
     exit(1);
 }
+
+int tsc_invariant()
+{
+    return 0;
+}
 #endif
 
 
@@ -201,6 +226,53 @@ double mhz(int verbose)
     return mhz_full(verbose, 2);
 }
 
+/* Estimate the cycle counter rate against the monotonic clock, spinning
+   for about 100 ms instead of sleeping for seconds */
+double tsc_mhz(int verbose)
+{
+    double rate, ns;
+
+    start_mono_counter();
+    start_counter();
+    do {
+	ns = get_mono_counter();
+    } while (ns < 1e8);
+    rate = get_counter() / (ns * 1e-3);
+    if (verbose) 
+	printf("Cycle counter rate ~= %.1f MHz\n", rate);
+    return rate;
+}
+
+/******************************************************* 
+ * The POSIX monotonic clock, in nanoseconds. The raw clock
+ * is not slewed by NTP, so it is the better yardstick.
+ *******************************************************/
+
+#ifdef CLOCK_MONOTONIC_RAW
+#define MONO_CLOCK CLOCK_MONOTONIC_RAW
+#else
+#define MONO_CLOCK CLOCK_MONOTONIC
+#endif
+
+static struct timespec mono_start;
+
+/* Record the current value of the monotonic clock. */
+void start_mono_counter()
+{
+    clock_gettime(MONO_CLOCK, &mono_start);
+}
+
+/* Return the number of nanoseconds since the last call to
+   start_mono_counter. */
+double get_mono_counter()
+{
+    struct timespec now;
+
+    clock_gettime(MONO_CLOCK, &now);
+    return (double)(now.tv_sec - mono_start.tv_sec) * 1e9 + 
+	(double)(now.tv_nsec - mono_start.tv_nsec);
+}
+
 /** Special counters that compensate for timer interrupt overhead */
 
 static double cyc_per_tick = 0.0;
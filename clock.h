@@ -15,6 +15,18 @@ double mhz(int verbose);
 /* Determine clock rate of processor, having more control over accuracy */
 double mhz_full(int verbose, int sleeptime);
 
+/* Determine counter rate quickly, by comparing with the monotonic clock */
+double tsc_mhz(int verbose);
+
+/* Does the cycle counter tick at a constant rate (x86 only)? */
+int tsc_invariant();
+
+/** Routines for using the POSIX monotonic clock (in nanoseconds) */
+
+void start_mono_counter();
+
+double get_mono_counter();
+
 /** Special counters that compensate for timer interrupt overhead */
 
 void start_comp_counter();
@@ -54,6 +54,44 @@
  */
 #define ALIGNMENT 8  
 
+/*
+ * Set to 1 if mm.c does its own locking. Otherwise the multi-threaded
+ * replay (-T) serializes every call into mm.c with one global lock.
+ * (Other packages say whether they are thread safe in allocator.c.)
+ */
+#define MM_THREADSAFE 0
+
+/*
+ * Set to 1 to have the driver break each trace's wasted space down by
+ * cause (headers, alignment, unsplit remainders, free blocks) at the
+ * utilization peak, and print the breakdown with -v. This costs one
+ * more replay of every trace.
+ */
+#ifndef MM_WASTE_STATS
+#define MM_WASTE_STATS 0
+#endif
+
+/*
+ * Set to 1 to shadow each segregated list with packed arrays of its
+ * blocks' sizes and heap offsets, in list order, so that fit searches
+ * and sorted inserts scan contiguous words (8 or 4 at a time when
+ * compiled with -mavx2 or -msse2) instead of following links through
+ * the blocks themselves.
+ */
+#ifndef MM_PACKED_LISTS
+#define MM_PACKED_LISTS 0
+#endif
+
+/*
+ * Set to 1 to have mm.c prefetch the next block's header as it walks a
+ * free list, and the neighbours' headers when it frees a block, so the
+ * misses overlap with the work on the current block. Compare runs with
+ * and without it with the driver's -P option.
+ */
+#ifndef MM_PREFETCH
+#define MM_PREFETCH 0
+#endif
+
 /* 
  * Maximum heap size in bytes 
  *
@@ -62,14 +100,21 @@
  * However, it seems to be reporting 'unlimited' thus the default 20MB
  * MAX_HEAP was maintained
  *
+ * The LD_PRELOAD shim (libmm.so) overrides this with -DMAX_HEAP, since
+ * real programs need a much larger heap than the traces do.
  */
+#ifndef MAX_HEAP
 #define MAX_HEAP (20*(1<<20))  /* 20 MB */
+#endif
 
 /*****************************************************************************
- * Set exactly one of these USE_xxx constants to "1" to select a timing method
+ * Set exactly one of these USE_xxx constants to "1" to select the default
+ * timing method. It can be changed at runtime with the driver's -c option.
  *****************************************************************************/
 #define USE_FCYC   0   /* cycle counter w/K-best scheme (x86 & Alpha only) */
+#define USE_TSC    0   /* invariant rdtscp counter w/K-best scheme (x86 only) */
+#define USE_MONO   1   /* clock_gettime w/K-best scheme (any POSIX box) */
 #define USE_ITIMER 0   /* interval timer (any Unix box) */
-#define USE_GETTOD 1   /* gettimeofday (any Unix box) */
+#define USE_GETTOD 0   /* gettimeofday (any Unix box) */
 
 #endif /* __CONFIG_H */
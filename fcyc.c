@@ -22,6 +22,7 @@
 #define CLEAR_CACHE 0        /* Clear cache before running test function */
 #define CACHE_BYTES (1<<19)  /* Max cache size in bytes */
 #define CACHE_BLOCK 32       /* Cache block size in bytes */
+#define COUNTER FCYC_CYCLES  /* Counter to sample */
 
 static int kbest = K;
 static int maxsamples = MAXSAMPLES;
@@ -30,9 +31,13 @@ static int compensate = COMPENSATE;
 static int clear_cache = CLEAR_CACHE;
 static int cache_bytes = CACHE_BYTES;
 static int cache_block = CACHE_BLOCK;
+static int counter = COUNTER;
 
 static int *cache_buf = NULL;
 
+static double paused = 0;   /* counter value at fcyc_pause */
+static double excluded = 0; /* counts to leave out of the current sample */
+
 static double *values = NULL;
 static int samplecount = 0;
 
@@ -123,6 +128,32 @@ static void clear()
     sink = x;
 }
 
+/*
+ * read_counter - Read the counter that is being sampled
+ */
+static double read_counter(void)
+{
+    if (counter == FCYC_MONO)
+	return get_mono_counter();
+    return get_counter();
+}
+
+/*
+ * fcyc_pause - Stop charging time to the current sample
+ */
+void fcyc_pause(void)
+{
+    paused = read_counter();
+}
+
+/*
+ * fcyc_resume - Charge time to the current sample again
+ */
+void fcyc_resume(void)
+{
+    excluded += read_counter() - paused;
+}
+
 /*
  * fcyc - Use K-best scheme to estimate the running time of function f
  */
@@ -130,25 +161,38 @@ double fcyc(test_funct f, void *argp)
 {
     double result;
     init_sampler();
-    if (compensate) {
+    if (counter == FCYC_MONO) {
+	do {
+	    double ns;
+	    if (clear_cache)
+		clear();
+	    excluded = 0;
+	    start_mono_counter();
+	    f(argp);
+	    ns = get_mono_counter();
+	    add_sample(ns - excluded);
+	} while (!has_converged() && samplecount < maxsamples);
+    } else if (compensate) {
 	do {
 	    double cyc;
 	    if (clear_cache)
 		clear();
+	    excluded = 0;
 	    start_comp_counter();
 	    f(argp);
 	    cyc = get_comp_counter();
-	    add_sample(cyc);
+	    add_sample(cyc - excluded);
 	} while (!has_converged() && samplecount < maxsamples);
     } else {
 	do {
 	    double cyc;
 	    if (clear_cache)
 		clear();
+	    excluded = 0;
 	    start_counter();
 	    f(argp);
 	    cyc = get_counter();
-	    add_sample(cyc);
+	    add_sample(cyc - excluded);
 	} while (!has_converged() && samplecount < maxsamples);
     }
 #ifdef DEBUG
@@ -245,6 +289,15 @@ void set_fcyc_epsilon(double epsilon_arg)
     epsilon = epsilon_arg;
 }
 
+/* 
+ * set_fcyc_counter - Counter sampled by fcyc: FCYC_CYCLES or FCYC_MONO.
+ *     Default = FCYC_CYCLES
+ */
+void set_fcyc_counter(int counter_arg)
+{
+    counter = counter_arg;
+}
+
 
 
 
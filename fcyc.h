@@ -13,6 +13,17 @@ typedef void (*test_funct)(void *);
 /* Compute number of cycles used by test function f */
 double fcyc(test_funct f, void* argp);
 
+/*
+ * fcyc_pause, fcyc_resume - Called by the test function to leave the
+ *     code between them out of the current sample
+ */
+void fcyc_pause(void);
+void fcyc_resume(void);
+
+/* Counters that fcyc can sample (see set_fcyc_counter) */
+#define FCYC_CYCLES 0  /* cycle counter in clock.c, in cycles */
+#define FCYC_MONO   1  /* POSIX monotonic clock, in nanoseconds */
+
 /*********************************************************
  * Set the various parameters used by measurement routines 
  *********************************************************/
@@ -63,6 +74,14 @@ void set_fcyc_maxsamples(int maxsamples_arg);
  */
 void set_fcyc_epsilon(double epsilon_arg);
 
+/* 
+ * set_fcyc_counter - Counter sampled by fcyc: FCYC_CYCLES or FCYC_MONO.
+ *     With FCYC_MONO, fcyc returns nanoseconds and compensation
+ *     for timer interrupts is not attempted.
+ *     Default = FCYC_CYCLES
+ */
+void set_fcyc_counter(int counter_arg);
+
 
 
 
@@ -2,6 +2,8 @@
  * High-level timing wrappers
  ****************************/
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "fsecs.h"
 #include "fcyc.h"
 #include "clock.h"
@@ -10,8 +12,173 @@
 
 static double Mhz;  /* estimated CPU clock frequency */
 
+/* Timing method, chosen in config.h and overridden by set_fsecs_timer */
+#if USE_FCYC
+static int timer = FSECS_FCYC;
+#elif USE_TSC
+static int timer = FSECS_TSC;
+#elif USE_MONO
+static int timer = FSECS_MONO;
+#elif USE_ITIMER
+static int timer = FSECS_ITIMER;
+#else
+static int timer = FSECS_GETTOD;
+#endif
+
+/* Names of the timing methods, indexed by FSECS_xxx */
+static char *timer_names[] = {"fcyc", "tsc", "mono", "itimer", "gettod"};
+
+/* Cache state, and the buffer used to get the cache into it */
+#define CACHE_LINE 64
+static int cache = FSECS_COLD;
+static int cache_bytes = 1<<19;
+static char *cache_buf = NULL;
+static char *cache_names[] = {"cold", "warm", "polluted"};
+
+/* The function being timed by fsecs */
+static fsecs_test_funct test_f;
+static volatile int sink = 0;
+
 extern int verbose; /* -v option in mdriver.c */
 
+/*
+ * set_fsecs_timer - select the timing method by name
+ */
+int set_fsecs_timer(char *name)
+{
+    int i;
+
+    for (i = 0; i < sizeof(timer_names) / sizeof(char *); i++) {
+	if (!strcmp(name, timer_names[i])) {
+	    timer = i;
+	    return 0;
+	}
+    }
+    return -1;
+}
+
+/*
+ * fsecs_timer_name - return the name of the timing method in use
+ */
+char *fsecs_timer_name(void)
+{
+    return timer_names[timer];
+}
+
+/*
+ * set_fsecs_cache - select the cache state by name
+ */
+int set_fsecs_cache(char *name)
+{
+    int i;
+
+    for (i = 0; i < sizeof(cache_names) / sizeof(char *); i++) {
+	if (!strcmp(name, cache_names[i])) {
+	    cache = i;
+	    return 0;
+	}
+    }
+    return -1;
+}
+
+/*
+ * fsecs_cache_name - return the name of the cache state in use
+ */
+char *fsecs_cache_name(void)
+{
+    return cache_names[cache];
+}
+
+/*
+ * set_fsecs_cache_size - size of the buffer that flushes or pollutes
+ *     the cache. To start really cold it must exceed the last level cache.
+ */
+void set_fsecs_cache_size(int bytes)
+{
+    cache_bytes = bytes;
+    free(cache_buf);
+    cache_buf = NULL;
+}
+
+/*
+ * touch_cache - read (flush) or read and write (pollute) one word in
+ *     each line of the cache buffer
+ */
+static void touch_cache(int write)
+{
+    int i, x = sink;
+
+    if (cache_buf == NULL && (cache_buf = calloc(1, cache_bytes)) == NULL) {
+	fprintf(stderr, "Fatal error.  Could not allocate the cache buffer\n");
+	exit(1);
+    }
+    for (i = 0; i < cache_bytes; i += CACHE_LINE) {
+	x += cache_buf[i];
+	if (write)
+	    cache_buf[i] = x;
+    }
+    sink = x;
+}
+
+/*
+ * fsecs_pause, fsecs_resume - leave the code between them out of the
+ *     measurement in progress
+ */
+void fsecs_pause(void)
+{
+    switch (timer) {
+    case FSECS_FCYC:
+    case FSECS_TSC:
+    case FSECS_MONO:
+	fcyc_pause();
+	break;
+    default:
+	ftimer_pause();
+    }
+}
+
+void fsecs_resume(void)
+{
+    switch (timer) {
+    case FSECS_FCYC:
+    case FSECS_TSC:
+    case FSECS_MONO:
+	fcyc_resume();
+	break;
+    default:
+	ftimer_resume();
+    }
+}
+
+/*
+ * fsecs_pollute - in the polluted cache state, touch the application
+ *     buffer, as a program would between its calls to malloc. The time
+ *     this takes is not measured. Does nothing in the other states.
+ */
+void fsecs_pollute(void)
+{
+    if (cache != FSECS_POLLUTED)
+	return;
+    fsecs_pause();
+    touch_cache(1);
+    fsecs_resume();
+}
+
+/*
+ * run_test - get the cache into the selected state, untimed, then run
+ *     the function being measured
+ */
+static void run_test(void *argp)
+{
+    if (cache == FSECS_COLD) {
+	fsecs_pause();
+	touch_cache(0);
+	fsecs_resume();
+    }
+    fsecs_pollute();
+    test_f(argp);
+}
+
 /*
  * init_fsecs - initialize the timing package
  */
@@ -19,39 +186,81 @@ void init_fsecs(void)
 {
     Mhz = 0; /* keep gcc -Wall happy */
 
-#if USE_FCYC
-    if (verbose)
-	printf("Measuring performance with a cycle counter.\n");
-
-    /* set key parameters for the fcyc package */
-    set_fcyc_maxsamples(20); 
-    set_fcyc_clear_cache(1);
-    set_fcyc_compensate(1);
-    set_fcyc_epsilon(0.01);
-    set_fcyc_k(3);
-    Mhz = mhz(verbose > 0);
-#elif USE_ITIMER
-    if (verbose)
-	printf("Measuring performance with the interval timer.\n");
-#elif USE_GETTOD
-    if (verbose)
-	printf("Measuring performance with gettimeofday().\n");
-#endif
+    switch (timer) {
+    case FSECS_FCYC:
+	if (verbose)
+	    printf("Measuring performance with a cycle counter.\n");
+
+	/* set key parameters for the fcyc package */
+	set_fcyc_maxsamples(20); 
+	set_fcyc_clear_cache(0); /* run_test does it */
+	set_fcyc_compensate(1);
+	set_fcyc_epsilon(0.01);
+	set_fcyc_k(3);
+	set_fcyc_counter(FCYC_CYCLES);
+	Mhz = mhz(verbose > 0);
+	break;
+
+    case FSECS_TSC:
+	/* A counter that changes rate with the clock speed is useless */
+	if (!tsc_invariant()) {
+	    printf("Cycle counter is not invariant, using the monotonic clock.\n");
+	    timer = FSECS_MONO;
+	    init_fsecs();
+	    return;
+	}
+	if (verbose)
+	    printf("Measuring performance with the invariant cycle counter.\n");
+	set_fcyc_maxsamples(20); 
+	set_fcyc_clear_cache(0); /* run_test does it */
+	set_fcyc_compensate(0);
+	set_fcyc_epsilon(0.01);
+	set_fcyc_k(3);
+	set_fcyc_counter(FCYC_CYCLES);
+	Mhz = tsc_mhz(verbose > 0);
+	break;
+
+    case FSECS_MONO:
+	if (verbose)
+	    printf("Measuring performance with clock_gettime().\n");
+	set_fcyc_maxsamples(20); 
+	set_fcyc_clear_cache(0); /* run_test does it */
+	set_fcyc_compensate(0);
+	set_fcyc_epsilon(0.01);
+	set_fcyc_k(3);
+	set_fcyc_counter(FCYC_MONO);
+	Mhz = 1000; /* the monotonic clock counts nanoseconds */
+	break;
+
+    case FSECS_ITIMER:
+	if (verbose)
+	    printf("Measuring performance with the interval timer.\n");
+	break;
+
+    case FSECS_GETTOD:
+	if (verbose)
+	    printf("Measuring performance with gettimeofday().\n");
+	break;
+    }
 }
 
 /*
- * fsecs - Return the running time of a function f (in seconds)
+ * fsecs - Return the running time of a function f (in seconds), with
+ *     the cache in the selected state at the start of each run
  */
 double fsecs(fsecs_test_funct f, void *argp) 
 {
-#if USE_FCYC
-    double cycles = fcyc(f, argp);
-    return cycles/(Mhz*1e6);
-#elif USE_ITIMER
-    return ftimer_itimer(f, argp, 10);
-#elif USE_GETTOD
-    return ftimer_gettod(f, argp, 10);
-#endif 
+    test_f = f;
+    switch (timer) {
+    case FSECS_FCYC:
+    case FSECS_TSC:
+    case FSECS_MONO:
+	return fcyc(run_test, argp)/(Mhz*1e6);
+    case FSECS_ITIMER:
+	return ftimer_itimer(run_test, argp, 10);
+    default:
+	return ftimer_gettod(run_test, argp, 10);
+    }
 }
 
 
@@ -1,4 +1,25 @@
 typedef void (*fsecs_test_funct)(void *);
 
+/* Timing methods (the default is set by the USE_xxx constants in config.h) */
+#define FSECS_FCYC   0  /* cycle counter w/K-best scheme */
+#define FSECS_TSC    1  /* invariant cycle counter w/K-best scheme */
+#define FSECS_MONO   2  /* clock_gettime w/K-best scheme */
+#define FSECS_ITIMER 3  /* interval timer */
+#define FSECS_GETTOD 4  /* gettimeofday */
+
+/* Cache state at the start of each measurement */
+#define FSECS_COLD     0  /* flushed by reading a large buffer */
+#define FSECS_WARM     1  /* left as the previous run left it */
+#define FSECS_POLLUTED 2  /* evicted and dirtied by an "application" buffer,
+			     also between batches of ops (fsecs_pollute) */
+
+int set_fsecs_timer(char *name);
+char *fsecs_timer_name(void);
+int set_fsecs_cache(char *name);
+char *fsecs_cache_name(void);
+void set_fsecs_cache_size(int bytes);
 void init_fsecs(void);
 double fsecs(fsecs_test_funct f, void *argp);
+void fsecs_pollute(void);
+void fsecs_pause(void);
+void fsecs_resume(void);
@@ -15,6 +15,10 @@
 /* function prototypes */
 static void init_etime(void);
 static double get_etime(void);
+static double get_tod(void);
+
+static double paused = 0;   /* time of ftimer_pause */
+static double excluded = 0; /* seconds to leave out of the measurement */
 
 /* 
  * ftimer_itimer - Use the interval timer to estimate the running time
@@ -26,10 +30,11 @@ double ftimer_itimer(ftimer_test_funct f, void *argp, int n)
     int i;
 
     init_etime();
+    excluded = 0;
     start = get_etime();
     for (i = 0; i < n; i++) 
 	f(argp);
-    tmeas = get_etime() - start;
+    tmeas = get_etime() - start - excluded;
     return tmeas / n;
 }
 
@@ -43,15 +48,41 @@ double ftimer_gettod(ftimer_test_funct f, void *argp, int n)
     struct timeval stv, etv;
     double diff;
 
+    excluded = 0;
     gettimeofday(&stv, NULL);
     for (i = 0; i < n; i++) 
 	f(argp);
     gettimeofday(&etv,NULL);
     diff = 1E3*(etv.tv_sec - stv.tv_sec) + 1E-3*(etv.tv_usec-stv.tv_usec);
+    diff -= 1E3*excluded;
     diff /= n;
     return (1E-3*diff);
 }
 
+/* 
+ * ftimer_pause - Stop charging time to the measurement in progress
+ */
+void ftimer_pause(void)
+{
+    paused = get_tod();
+}
+
+/* 
+ * ftimer_resume - Charge time to the measurement in progress again
+ */
+void ftimer_resume(void)
+{
+    excluded += get_tod() - paused;
+}
+
+/* return the time of day in seconds */
+static double get_tod(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + 1e-6 * tv.tv_usec;
+}
 
 /*
  * Routines for manipulating the Unix interval timer
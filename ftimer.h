@@ -12,3 +12,7 @@ double ftimer_itimer(ftimer_test_funct f, void *argp, int n);
    Return the average of n runs */
 double ftimer_gettod(ftimer_test_funct f, void *argp, int n);
 
+/* Called by f to leave the code between them out of the measurement */
+void ftimer_pause(void);
+void ftimer_resume(void);
+
@@ -0,0 +1,143 @@
+/*
+ * lathist.c - Log-linear (HDR-style) latency histograms
+ *
+ * A value v below LH_SUB goes in bucket v. Larger values are written
+ * as mant << e with LH_HALF <= mant < LH_SUB, and go in bucket
+ * e*LH_HALF + mant. Recording is a count-leading-zeros and a shift.
+ */
+#include <string.h>
+
+#include "lathist.h"
+
+/*
+ * lh_bucket - Return the bucket that holds value v
+ */
+static int lh_bucket(lh_val_t v)
+{
+    int e;
+
+    if (v < LH_SUB)
+	return (int)v;
+    e = (63 - __builtin_clzll(v)) - (LH_SUB_BITS - 1);
+    return e * LH_HALF + (int)(v >> e);
+}
+
+/*
+ * lh_highest - Return the largest value that maps to bucket b
+ */
+static lh_val_t lh_highest(int b)
+{
+    int e;
+    lh_val_t mant;
+
+    if (b < LH_SUB)
+	return b;
+    e = b / LH_HALF - 1;
+    mant = b % LH_HALF + LH_HALF;
+    return ((mant + 1) << e) - 1;
+}
+
+/*
+ * lh_reset - Empty the histogram
+ */
+void lh_reset(lathist_t *h)
+{
+    memset(h, 0, sizeof(lathist_t));
+}
+
+/*
+ * lh_keep_worst - Remember (val, opnum) if it is among the LH_WORST
+ *     largest samples, which are kept largest first
+ */
+static void lh_keep_worst(lathist_t *h, lh_val_t val, int opnum)
+{
+    int pos;
+
+    if (h->nworst < LH_WORST)
+	pos = h->nworst++;
+    else if (val > h->worst_val[LH_WORST-1])
+	pos = LH_WORST-1;
+    else
+	return;
+
+    /* Insertion sort */
+    while (pos > 0 && h->worst_val[pos-1] < val) {
+	h->worst_val[pos] = h->worst_val[pos-1];
+	h->worst_op[pos] = h->worst_op[pos-1];
+	pos--;
+    }
+    h->worst_val[pos] = val;
+    h->worst_op[pos] = opnum;
+}
+
+/*
+ * lh_record - Record a sample of val produced by operation opnum
+ */
+void lh_record(lathist_t *h, lh_val_t val, int opnum)
+{
+    h->counts[lh_bucket(val)]++;
+    h->total++;
+    if (val > h->max)
+	h->max = val;
+    lh_keep_worst(h, val, opnum);
+}
+
+/*
+ * lh_merge - Add all of the samples in src to dst
+ */
+void lh_merge(lathist_t *dst, lathist_t *src)
+{
+    int i;
+
+    for (i = 0; i < LH_BUCKETS; i++)
+	dst->counts[i] += src->counts[i];
+    dst->total += src->total;
+    if (src->max > dst->max)
+	dst->max = src->max;
+    for (i = 0; i < src->nworst; i++)
+	lh_keep_worst(dst, src->worst_val[i], src->worst_op[i]);
+}
+
+/*
+ * lh_percentile - Return the value at quantile q, 0 <= q <= 1. The
+ *     answer is the highest value of the bucket that holds the sample,
+ *     capped at the largest sample seen.
+ */
+lh_val_t lh_percentile(lathist_t *h, double q)
+{
+    lh_val_t rank, seen = 0;
+    lh_val_t v;
+    int b;
+
+    if (h->total == 0)
+	return 0;
+    rank = (lh_val_t)(q * h->total + 0.5);
+    if (rank < 1)
+	rank = 1;
+    for (b = 0; b < LH_BUCKETS; b++) {
+	seen += h->counts[b];
+	if (seen >= rank)
+	    break;
+    }
+    v = lh_highest(b);
+    return (v < h->max) ? v : h->max;
+}
+
+/*
+ * lh_overhead - Estimate the cost of an lh_now() pair as the smallest
+ *     of many back-to-back readings
+ */
+lh_val_t lh_overhead(void)
+{
+    lh_val_t best = ~0ULL;
+    lh_val_t start, diff;
+    int i;
+
+    for (i = 0; i < 1000; i++) {
+	start = lh_now();
+	diff = lh_now() - start;
+	if (diff < best)
+	    best = diff;
+    }
+    return best;
+}
@@ -0,0 +1,66 @@
+/*
+ * lathist.h - Log-linear (HDR-style) latency histograms
+ *
+ * Values (typically cycle counts) are bucketed by their leading
+ * LH_SUB_BITS bits, so every bucket is within ~3% of the values it
+ * holds, from 1 cycle up to 2^64, in a fixed LH_BUCKETS-entry array.
+ */
+
+/* Number of significant bits kept per value */
+#define LH_SUB_BITS 5
+#define LH_SUB      (1 << LH_SUB_BITS)
+#define LH_HALF     (LH_SUB >> 1)
+#define LH_BUCKETS  ((64 - LH_SUB_BITS + 1) * LH_HALF + LH_HALF)
+
+/* Number of worst samples remembered per histogram */
+#define LH_WORST 5
+
+typedef unsigned long long lh_val_t;
+
+typedef struct {
+    lh_val_t counts[LH_BUCKETS]; /* samples per bucket */
+    lh_val_t total;              /* number of samples */
+    lh_val_t max;                /* largest sample */
+    int nworst;                  /* valid entries in worst_*[] */
+    lh_val_t worst_val[LH_WORST];/* largest samples, largest first... */
+    int worst_op[LH_WORST];      /* ... and the ops that produced them */
+} lathist_t;
+
+/* Empty the histogram */
+void lh_reset(lathist_t *h);
+
+/* Record a sample of val produced by operation opnum */
+void lh_record(lathist_t *h, lh_val_t val, int opnum);
+
+/* Add all of the samples in src to dst */
+void lh_merge(lathist_t *dst, lathist_t *src);
+
+/* Return the (bucket-rounded) value at quantile q, 0 <= q <= 1 */
+lh_val_t lh_percentile(lathist_t *h, double q);
+
+/*
+ * lh_now - Read the cycle counter. rdtscp waits for all earlier
+ *     instructions to retire, so a pair of calls brackets exactly the
+ *     code between them. Other platforms fall back to nanoseconds.
+ */
+#if defined(__i386__) || defined(__x86_64__)
+static inline lh_val_t lh_now(void)
+{
+    unsigned hi, lo;
+
+    asm volatile("rdtscp" : "=a" (lo), "=d" (hi) : : "%ecx", "memory");
+    return ((lh_val_t)hi << 32) | lo;
+}
+#else
+#include <time.h>
+static inline lh_val_t lh_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (lh_val_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+#endif
+
+/* Estimate the cost of an lh_now() pair, to subtract from each sample */
+lh_val_t lh_overhead(void);
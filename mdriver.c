@@ -7,6 +7,7 @@
  * Copyright (c) 2002, R. Bryant and D. O'Hallaron, All rights reserved.
  * May not be used, modified, or copied without permission.
  */
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -15,10 +16,18 @@
 #include <assert.h>
 #include <float.h>
 #include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <getopt.h>
+#include <math.h>
+#include <sys/wait.h>
 
 #include "mm.h"
 #include "memlib.h"
+#include "allocator.h"
 #include "fsecs.h"
+#include "lathist.h"
+#include "perfctr.h"
 #include "config.h"
 
 /**********************
@@ -27,9 +36,44 @@
 
 /* Misc */
 #define MAXLINE     1024 /* max string size */
+#define MAXREPEAT    100 /* max number of repeated speed measurements */
+#define MAXALLOCS     16 /* max number of packages evaluated in one run */
 #define HDRLINES       4 /* number of header lines in a trace file */
 #define LINENUM(i) (i+5) /* cnvt trace request nums to linenums (origin 1) */
 
+/* Build flags, passed in by the Makefile, for the results file */
+#ifndef BUILD_FLAGS
+#define BUILD_FLAGS "unknown"
+#endif
+
+/* Long options that have no single-letter equivalent */
+#define OPT_JSON      256
+#define OPT_CSV       257
+#define OPT_BASELINE  258
+#define OPT_REPEAT    259
+#define OPT_TOLERANCE 260
+#define OPT_TIMELINE  261
+#define OPT_INTERVAL  262
+#define OPT_CACHE_KB  263
+#define OPT_POLLUTE   264
+#define OPT_TOUCH     265
+#define OPT_TOUCH_SEQ 266
+#define OPT_SEARCH    267
+#define OPT_BUDGET    268
+#define OPT_SLACK     269
+#define OPT_RESET     270
+
+/* How each timing run starts over (--reset) */
+#define RESET_INIT     0  /* mem_reset_brk and mm_init, as always */
+#define RESET_SNAPSHOT 1  /* restore a snapshot taken just after mm_init */
+#define RESET_CLEAN    2  /* the same, prefaulted and flushed from the cache */
+
+/* Bytes between the payload words that the touching replay accesses */
+#define TOUCH_LINE 64
+
+/* Request size classes reported by the latency mode (-L) */
+#define LAT_CLASSES 5  /* plus one more histogram for all sizes */
+
 /* Returns true if p is ALIGNMENT-byte aligned */
 #define IS_ALIGNED(p)  ((((unsigned int)(p)) % ALIGNMENT) == 0)
 
@@ -70,8 +114,36 @@ typedef struct {
 typedef struct {
     trace_t *trace;  
     range_t *ranges;
+    int *live;       /* ids of the live blocks (--touch)... */
+    int *livepos;    /* ... and the position of each id in live[] */
 } speed_t;
 
+/* The work done by one thread in the multi-threaded replay (-T) */
+typedef struct {
+    trace_t *trace;  /* trace to replay... */
+    int shard;       /* ... but only the ids with index % nshards == shard */
+    int nshards;
+    char **blocks;   /* this thread's block pointers, by id */
+    int ops;         /* number of requests replayed */
+    double start;    /* when the replay started and ended (secs) */
+    double end;
+} mt_work_t;
+
+/*
+ * Where the final heap went, in bytes (MM_WASTE_STATS). Everything but
+ * growth is measured when the live payload peaks.
+ */
+typedef struct {
+    double heap;     /* final heap size */
+    double payload;  /* live payload at the peak */
+    double overhead; /* headers and footers of the live blocks */
+    double align;    /* rounding of the requests to block sizes */
+    double unsplit;  /* remainders too small to split off */
+    double free;     /* free blocks */
+    double other;    /* the rest, e.g., prologue and list heads */
+    double growth;   /* heap added after the peak */
+} waste_t;
+
 /* Summarizes the important stats for some malloc function on some trace */
 typedef struct {
     /* defined for both libc malloc and student malloc package (mm.c) */
@@ -81,15 +153,46 @@ typedef struct {
 
     /* defined only for the student malloc package */
     double util;     /* space utilization for this trace (always 0 for libc) */
+    double noise;    /* relative std deviation of repeated secs (--repeat) */
+    double perf[PERF_NEVENTS]; /* hardware events per op (-P), -1 if n/a */
+    waste_t waste;   /* wasted space by cause (MM_WASTE_STATS) */
+    double touch_secs; /* secs including payload accesses (--touch) */
 
     /* Note: secs and util are only defined if valid is true */
 } stats_t; 
 
+/* One trace's results in a baseline file (--baseline) */
+typedef struct {
+    char allocator[MAXLINE]; /* package name */
+    char file[MAXLINE]; /* trace file name */
+    int valid;
+    double util;
+    double kops;
+    double noise;
+} baseline_t;
+
+/* What a worker process of the parallel evaluation (-j) reports back */
+typedef struct {
+    int errors;      /* number of errs the worker found */
+    stats_t stats;   /* the stats for its trace */
+} result_t;
+
 /********************
  * Global variables
  *******************/
 int verbose = 0;        /* global flag for verbose output */
 static int errors = 0;  /* number of errs found when running student malloc */
+static int latency = 0; /* report per-request latencies (-L) */
+static int perfctr = 0; /* report hardware counters (-P) */
+static int nrepeat = 1; /* times to repeat each speed measurement */
+static int pollute_ops = 0; /* ops between cache pollutions (-C polluted) */
+static int touch_pct = 0;   /* % of live blocks touched per request (--touch) */
+static int touch_seq = 0;   /* touch them in id order, not at random */
+static int search_policy = MM_SEARCH_FIRST; /* mm.c's fit search (--search) */
+static int search_budget = 8;  /* good fit: fitting blocks looked at... */
+static int search_slack = 10;  /* ... unless one is within this percent */
+static int heap_reset = RESET_INIT; /* how timing runs start over (--reset) */
+static allocator_t *alloc; /* the malloc package being evaluated */
 char msg[MAXLINE];      /* for whenever we need to compose an error message */
 
 /* Directory where default tracefiles are found */
@@ -100,6 +203,30 @@ static char *default_tracefiles[] = {
     DEFAULT_TRACEFILES, NULL
 };
 
+/* Upper size bound and name of each latency size class */
+static int lat_class_max[LAT_CLASSES] = {64, 512, 4096, 32768, 0x7fffffff};
+static char *lat_class_names[LAT_CLASSES+1] = {
+    "1-64", "65-512", "513-4K", "4K-32K", ">32K", "all"
+};
+static char *lat_op_names[] = {"malloc", "free", "realloc"};
+
+/* Names of the ways to reset the heap, indexed by RESET_xxx */
+static char *reset_names[] = {"init", "snapshot", "clean", NULL};
+
+/* Names of mm.c's search policies, indexed by MM_SEARCH_xxx */
+static char *search_names[] = {"first", "next", "best", "good", NULL};
+
+/* Number of eval_mm_speed runs covered by the hardware counters */
+static int perf_runs = 0;
+
+/* 
+ * The multi-threaded replay serializes packages that are not thread
+ * safe with one lock. All threads are released from mt_barrier at the
+ * same moment.
+ */
+static pthread_mutex_t mt_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_barrier_t mt_barrier;
+
 
 /********************* 
  * Function prototypes 
@@ -115,18 +242,53 @@ static void clear_ranges(range_t **ranges);
 static trace_t *read_trace(char *tracedir, char *filename);
 static void free_trace(trace_t *trace);
 
-/* Routines for evaluating the correctness and speed of libc malloc */
-static int eval_libc_valid(trace_t *trace, int tracenum);
-static void eval_libc_speed(void *ptr);
-
 /* Routines for evaluating correctnes, space utilization, and speed 
    of the student's malloc package in mm.c */
 static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges);
 static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges);
+#if MM_WASTE_STATS
+static void eval_mm_waste(trace_t *trace, int tracenum, waste_t *waste);
+#endif
 static void eval_mm_speed(void *ptr);
+static void eval_mm_speed_perf(void *ptr);
+static void eval_mm_speed_touch(void *ptr);
+static void touch_block(char *p, int size);
+static void pollute_cache(void);
+static void eval_mm_latency(trace_t *trace, int tracenum);
+static void eval_mm_timeline(FILE *fp, char *tracefile, int tracenum,
+			     int interval);
+static void timeline_sample(FILE *fp, int tracenum, int opnum, 
+			    int live);
+static void eval_mm_trace(char *tracefile, int tracenum, stats_t *stats);
+
+/* Routines for evaluating several traces at once in worker processes */
+static void eval_mm_parallel(char **tracefiles, int num_tracefiles,
+			     stats_t *stats, int njobs);
+static void pin_cpu(int cpu);
+
+/* Routines for replaying traces on several threads at once */
+static void eval_mm_threads(char **tracefiles, int num_tracefiles, 
+			    int nthreads);
+static double mt_run(mt_work_t *work, int nwork, int nthreads);
+static void *mt_thread(void *vargp);
+static void mt_replay(mt_work_t *w);
 
 /* Various helper routines */
 static void printresults(int n, stats_t *stats);
+static void printperf(int n, stats_t *stats);
+#if MM_WASTE_STATS
+static void printwaste(int n, stats_t *stats);
+#endif
+static void printtouch(int n, stats_t *stats);
+static void printcompare(int n, int nallocs, allocator_t **allocs,
+			 stats_t **stats);
+static void write_results(char *filename, int csv, char **tracefiles,
+			  int n, int nallocs, allocator_t **allocs, 
+			  stats_t **stats, double perfindex);
+static int compare_baseline(char *filename, char **tracefiles, int n,
+			    int nallocs, allocator_t **allocs, 
+			    stats_t **stats, double tolerance);
+static char *search_desc(void);
 static void usage(void);
 static void unix_error(char *msg);
 static void malloc_error(int tracenum, int opnum, char *msg);
@@ -137,19 +299,49 @@ static void app_error(char *msg);
  **************/
 int main(int argc, char **argv)
 {
-    int i;
-    char c;
+    int i, a;
+    int c;
     char **tracefiles = NULL;  /* null-terminated array of trace file names */
     int num_tracefiles = 0;    /* the number of traces in that array */
-    trace_t *trace = NULL;     /* stores a single trace file in memory */
-    range_t *ranges = NULL;    /* keeps track of block extents for one trace */
-    stats_t *libc_stats = NULL;/* libc stats for each trace */
-    stats_t *mm_stats = NULL;  /* mm (i.e. student) stats for each trace */
-    speed_t speed_params;      /* input parameters to the xx_speed routines */ 
+    allocator_t *allocs[MAXALLOCS]; /* the packages to evaluate */
+    stats_t *stats[MAXALLOCS]; /* their stats for each trace */
+    int nallocs = 0;           /* the number of packages */
+    int primary = 0;           /* the package that gets the perf index */
+    stats_t *mm_stats = NULL;  /* the primary package's stats */
 
     int team_check = 1;  /* If set, check team structure (reset by -a) */
     int run_libc = 0;    /* If set, run libc malloc (set by -l) */
     int autograder = 0;  /* If set, emit summary info for autograder (-g) */
+    int nthreads = 0;    /* If set, also replay on this many threads (-T) */
+    int njobs = 0;       /* If set, evaluate this many traces at once (-j) */
+    char *json_file = NULL;    /* If set, write results as JSON (--json) */
+    char *csv_file = NULL;     /* If set, write results as CSV (--csv) */
+    char *baseline = NULL;     /* If set, compare with these results */
+    double tolerance = 0.05;   /* allowed throughput loss vs. baseline */
+    char *timeline = NULL;     /* If set, write the fragmentation timeline */
+    int interval = 100;        /* ops between timeline samples */
+    int batch = 100;           /* ops between cache pollutions */
+    FILE *timeline_fp = NULL;
+    int regressed = 0;
+
+    static struct option long_options[] = {
+	{"json", required_argument, NULL, OPT_JSON},
+	{"csv", required_argument, NULL, OPT_CSV},
+	{"baseline", required_argument, NULL, OPT_BASELINE},
+	{"repeat", required_argument, NULL, OPT_REPEAT},
+	{"tolerance", required_argument, NULL, OPT_TOLERANCE},
+	{"timeline", required_argument, NULL, OPT_TIMELINE},
+	{"interval", required_argument, NULL, OPT_INTERVAL},
+	{"cache-kb", required_argument, NULL, OPT_CACHE_KB},
+	{"pollute-ops", required_argument, NULL, OPT_POLLUTE},
+	{"touch", required_argument, NULL, OPT_TOUCH},
+	{"touch-order", required_argument, NULL, OPT_TOUCH_SEQ},
+	{"search", required_argument, NULL, OPT_SEARCH},
+	{"search-budget", required_argument, NULL, OPT_BUDGET},
+	{"search-slack", required_argument, NULL, OPT_SLACK},
+	{"reset", required_argument, NULL, OPT_RESET},
+	{NULL, 0, NULL, 0}
+    };
 
     /* temporaries used to compute the performance index */
     double secs, ops, util, avg_mm_util, avg_mm_throughput, p1, p2, perfindex;
@@ -158,8 +350,109 @@ int main(int argc, char **argv)
     /* 
      * Read and interpret the command line arguments 
      */
-    while ((c = getopt(argc, argv, "f:t:hvVgal")) != EOF) {
+    while ((c = getopt_long(argc, argv, "f:t:c:C:m:T:j:hvVgalLP", 
+			    long_options, NULL)) != EOF) {
         switch (c) {
+	case OPT_JSON: /* Write machine-readable results */
+	    json_file = optarg;
+	    break;
+	case OPT_CSV:
+	    csv_file = optarg;
+	    break;
+	case OPT_BASELINE: /* Compare with stored results */
+	    baseline = optarg;
+	    if (nrepeat == 1)
+		nrepeat = 3; /* so that we know how noisy the timings are */
+	    break;
+	case OPT_REPEAT: /* Repeat each speed measurement */
+	    nrepeat = atoi(optarg);
+	    if (nrepeat < 1 || nrepeat > MAXREPEAT) {
+		usage();
+		exit(1);
+	    }
+	    break;
+	case OPT_TOLERANCE: /* Throughput loss allowed, in percent */
+	    tolerance = atof(optarg) / 100.0;
+	    break;
+	case OPT_TIMELINE: /* Sample the heap's free space as the trace runs */
+	    timeline = optarg;
+	    break;
+	case OPT_INTERVAL:
+	    if ((interval = atoi(optarg)) < 1) {
+		usage();
+		exit(1);
+	    }
+	    break;
+	case OPT_CACHE_KB: /* Size of the cache flushing/polluting buffer */
+	    if (atoi(optarg) < 1) {
+		usage();
+		exit(1);
+	    }
+	    set_fsecs_cache_size(atoi(optarg) * 1024);
+	    break;
+	case OPT_POLLUTE:
+	    if ((batch = atoi(optarg)) < 1) {
+		usage();
+		exit(1);
+	    }
+	    break;
+	case OPT_TOUCH: /* Access payloads as the trace runs */
+	    touch_pct = atoi(optarg);
+	    if (touch_pct < 1 || touch_pct > 100) {
+		usage();
+		exit(1);
+	    }
+	    break;
+	case OPT_TOUCH_SEQ:
+	    if (!strcmp(optarg, "seq"))
+		touch_seq = 1;
+	    else if (!strcmp(optarg, "random"))
+		touch_seq = 0;
+	    else {
+		usage();
+		exit(1);
+	    }
+	    break;
+	case OPT_SEARCH: /* Which fitting block mm.c takes */
+	    for (i = 0; search_names[i] != NULL; i++)
+		if (!strcmp(optarg, search_names[i]))
+		    break;
+	    if (search_names[i] == NULL) {
+		usage();
+		exit(1);
+	    }
+	    search_policy = i;
+	    break;
+	case OPT_BUDGET:
+	    if ((search_budget = atoi(optarg)) < 1) {
+		usage();
+		exit(1);
+	    }
+	    break;
+	case OPT_SLACK:
+	    if ((search_slack = atoi(optarg)) < 0) {
+		usage();
+		exit(1);
+	    }
+	    break;
+	case OPT_RESET: /* How each timing run starts with a fresh heap */
+	    for (i = 0; reset_names[i] != NULL; i++)
+		if (!strcmp(optarg, reset_names[i]))
+		    break;
+	    if (reset_names[i] == NULL) {
+		usage();
+		exit(1);
+	    }
+	    heap_reset = i;
+	    break;
+	case 'm': /* Evaluate this package (may be repeated) */
+	    if (nallocs == MAXALLOCS - 1 ||
+		(allocs[nallocs] = find_allocator(optarg)) == NULL) {
+		usage();
+		exit(1);
+	    }
+	    nallocs++;
+	    break;
 	case 'g': /* Generate summary info for the autograder */
 	    autograder = 1;
 	    break;
@@ -178,12 +471,42 @@ int main(int argc, char **argv)
 	    if (tracedir[strlen(tracedir)-1] != '/') 
 		strcat(tracedir, "/"); /* path always ends with "/" */
 	    break;
+        case 'c': /* Timing method */
+	    if (set_fsecs_timer(optarg) < 0) {
+		usage();
+		exit(1);
+	    }
+	    break;
+        case 'C': /* Cache state for the speed measurements */
+	    if (set_fsecs_cache(optarg) < 0) {
+		usage();
+		exit(1);
+	    }
+	    break;
         case 'a': /* Don't check team structure */
             team_check = 0;
             break;
         case 'l': /* Run libc malloc */
             run_libc = 1;
             break;
+        case 'L': /* Report per-request latency percentiles */
+            latency = 1;
+            break;
+        case 'P': /* Report hardware performance counters */
+            perfctr = 1;
+            break;
+        case 'j': /* Evaluate traces in parallel worker processes */
+            if ((njobs = atoi(optarg)) < 1) {
+		usage();
+		exit(1);
+	    }
+            break;
+        case 'T': /* Replay concurrently on this many threads */
+            if ((nthreads = atoi(optarg)) < 1) {
+		usage();
+		exit(1);
+	    }
+            break;
         case 'v': /* Print per-trace performance breakdown */
             verbose = 1;
             break;
@@ -237,82 +560,114 @@ int main(int argc, char **argv)
 
     /* Initialize the timing package */
     init_fsecs();
+    if (!strcmp(fsecs_cache_name(), "polluted"))
+	pollute_ops = batch;
+
+    /* Open the hardware counters, or carry on without them */
+    if (perfctr && perf_init() == 0) {
+	printf("Hardware performance counters unavailable, ignoring -P.\n");
+	perfctr = 0;
+    }
 
     /*
-     * Optionally run and evaluate the libc malloc package 
+     * Evaluate the mm package unless -m picked others, and with -l,
+     * libc malloc ahead of them. The first package picked gets the
+     * performance index.
      */
+    if (nallocs == 0)
+	allocs[nallocs++] = find_allocator("mm");
+    for (a = 0; a < nallocs; a++)
+	if (allocs[a] == find_allocator("libc"))
+	    run_libc = 0; /* already picked with -m */
     if (run_libc) {
-	if (verbose > 1)
-	    printf("\nTesting libc malloc\n");
-	
-	/* Allocate libc stats array, with one stats_t struct per tracefile */
-	libc_stats = (stats_t *)calloc(num_tracefiles, sizeof(stats_t));
-	if (libc_stats == NULL)
-	    unix_error("libc_stats calloc in main failed");
-	
-	/* Evaluate the libc malloc package using the K-best scheme */
-	for (i=0; i < num_tracefiles; i++) {
-	    trace = read_trace(tracedir, tracefiles[i]);
-	    libc_stats[i].ops = trace->num_ops;
-	    if (verbose > 1)
-		printf("Checking libc malloc for correctness, ");
-	    libc_stats[i].valid = eval_libc_valid(trace, i);
-	    if (libc_stats[i].valid) {
-		speed_params.trace = trace;
-		if (verbose > 1)
-		    printf("and performance.\n");
-		libc_stats[i].secs = fsecs(eval_libc_speed, &speed_params);
-	    }
-	    free_trace(trace);
-	}
-
-	/* Display the libc results in a compact table */
-	if (verbose) {
-	    printf("\nResults for libc malloc:\n");
-	    printresults(num_tracefiles, libc_stats);
-	}
+	for (a = nallocs; a > 0; a--)
+	    allocs[a] = allocs[a-1];
+	allocs[0] = find_allocator("libc");
+	nallocs++;
+	primary = 1;
     }
 
-    /*
-     * Always run and evaluate the student's mm package
-     */
-    if (verbose > 1)
-	printf("\nTesting mm malloc\n");
+    /* mm.c's search policy holds for every mm package */
+    mm_set_search(search_policy, search_budget, search_slack);
+    for (a = 0; a < nallocs; a++)
+	if (allocs[a]->uses_memlib) {
+	    printf("Fit search: %s\n", search_desc());
+	    if (heap_reset != RESET_INIT)
+		printf("Heap reset: %s\n", reset_names[heap_reset]);
+	    break;
+	}
 
-    /* Allocate the mm stats array, with one stats_t struct per tracefile */
-    mm_stats = (stats_t *)calloc(num_tracefiles, sizeof(stats_t));
-    if (mm_stats == NULL)
-	unix_error("mm_stats calloc in main failed");
-    
     /* Initialize the simulated memory system in memlib.c */
     mem_init(); 
 
-    /* Evaluate student's mm malloc package using the K-best scheme */
-    for (i=0; i < num_tracefiles; i++) {
-	trace = read_trace(tracedir, tracefiles[i]);
-	mm_stats[i].ops = trace->num_ops;
+    if (timeline && (timeline_fp = fopen(timeline, "w")) == NULL) {
+	sprintf(msg, "Could not open %s in main", timeline);
+	unix_error(msg);
+    }
+
+    for (a = 0; a < nallocs; a++) {
+	alloc = allocs[a];
 	if (verbose > 1)
-	    printf("Checking mm_malloc for correctness, ");
-	mm_stats[i].valid = eval_mm_valid(trace, i, &ranges);
-	if (mm_stats[i].valid) {
-	    if (verbose > 1)
-		printf("efficiency, ");
-	    mm_stats[i].util = eval_mm_util(trace, i, &ranges);
-	    speed_params.trace = trace;
-	    speed_params.ranges = ranges;
-	    if (verbose > 1)
-		printf("and performance.\n");
-	    mm_stats[i].secs = fsecs(eval_mm_speed, &speed_params);
-	}
-	free_trace(trace);
-    }
-
-    /* Display the mm results in a compact table */
-    if (verbose) {
-	printf("\nResults for mm malloc:\n");
-	printresults(num_tracefiles, mm_stats);
+	    printf("\nTesting %s malloc\n", alloc->name);
+
+	/* Allocate the stats array, with one stats_t struct per tracefile */
+	stats[a] = (stats_t *)calloc(num_tracefiles, sizeof(stats_t));
+	if (stats[a] == NULL)
+	    unix_error("stats calloc in main failed");
+    
+	/* Evaluate the malloc package using the K-best scheme */
+	if (njobs)
+	    eval_mm_parallel(tracefiles, num_tracefiles, stats[a], njobs);
+	else {
+	    for (i=0; i < num_tracefiles; i++)
+		eval_mm_trace(tracefiles[i], i, &stats[a][i]);
+	}
+
+	/* Display the results in a compact table */
+	if (verbose) {
+	    printf("\nResults for %s malloc:\n", alloc->name);
+	    printresults(num_tracefiles, stats[a]);
+	    printf("\n");
+#if MM_WASTE_STATS
+	    if (alloc->blockwaste) {
+		printf("Wasted space for %s malloc, in %% of the heap:\n",
+		       alloc->name);
+		printwaste(num_tracefiles, stats[a]);
+		printf("\n");
+	    }
+#endif
+	}
+	if (perfctr) {
+	    printf("Hardware events per op for %s malloc%s:\n", alloc->name,
+		   (alloc->uses_memlib && mm_prefetch) ? " (prefetching)" : "");
+	    printperf(num_tracefiles, stats[a]);
+	    printf("\n");
+	}
+	if (touch_pct) {
+	    printf("Replay touching %d%% of the live blocks per request, "
+		   "%s malloc:\n", touch_pct, alloc->name);
+	    printtouch(num_tracefiles, stats[a]);
+	    printf("\n");
+	}
+
+	/* Replay the valid traces once more, sampling the free space */
+	if (timeline_fp && alloc->heapstats == NULL)
+	    printf("No heap statistics for %s malloc, no timeline.\n",
+		   alloc->name);
+	else if (timeline_fp) {
+	    for (i=0; i < num_tracefiles; i++)
+		if (stats[a][i].valid)
+		    eval_mm_timeline(timeline_fp, tracefiles[i], i, interval);
+	}
+    }
+    if (timeline_fp)
+	fclose(timeline_fp);
+    if (nallocs > 1) {
+	printcompare(num_tracefiles, nallocs, allocs, stats);
 	printf("\n");
     }
+    alloc = allocs[primary];
+    mm_stats = stats[primary];
 
     /* 
      * Accumulate the aggregate statistics for the student's mm package 
@@ -362,7 +717,22 @@ int main(int argc, char **argv)
 	printf("perfidx:%.0f\n", perfindex);
     }
 
-    exit(0);
+    /* Save the results and check them against the baseline */
+    if (json_file)
+	write_results(json_file, 0, tracefiles, num_tracefiles, nallocs,
+		      allocs, stats, perfindex);
+    if (csv_file)
+	write_results(csv_file, 1, tracefiles, num_tracefiles, nallocs,
+		      allocs, stats, perfindex);
+    if (baseline)
+	regressed = compare_baseline(baseline, tracefiles, num_tracefiles,
+				     nallocs, allocs, stats, tolerance);
+
+    /* Measure scalability once we know the package is correct */
+    if (nthreads && errors == 0)
+	eval_mm_threads(tracefiles, num_tracefiles, nthreads);
+
+    exit(regressed ? 2 : 0);
 }
 
 
@@ -396,8 +766,9 @@ static int add_range(range_t **ranges, char *lo, int size,
     }
 
     /* The payload must lie within the extent of the heap */
-    if ((lo < (char *)mem_heap_lo()) || (lo > (char *)mem_heap_hi()) || 
-	(hi < (char *)mem_heap_lo()) || (hi > (char *)mem_heap_hi())) {
+    if (alloc->uses_memlib &&
+	((lo < (char *)mem_heap_lo()) || (lo > (char *)mem_heap_hi()) || 
+	 (hi < (char *)mem_heap_lo()) || (hi > (char *)mem_heap_hi()))) {
 	sprintf(msg, "Payload (%p:%p) lies outside heap (%p:%p)",
 		lo, hi, mem_heap_lo(), mem_heap_hi());
 	malloc_error(tracenum, opnum, msg);
@@ -585,11 +956,10 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
     char *p;
     
     /* Reset the heap and free any records in the range list */
-    mem_reset_brk();
     clear_ranges(ranges);
 
-    /* Call the mm package's init function */
-    if (mm_init() < 0) {
+    /* Reset the heap and call the package's init function */
+    if (alloc->init() < 0) {
 	malloc_error(tracenum, 0, "mm_init failed.");
 	return 0;
     }
@@ -604,7 +974,7 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
         case ALLOC: /* mm_malloc */
 
 	    /* Call the student's malloc */
-	    if ((p = mm_malloc(size)) == NULL) {
+	    if ((p = alloc->malloc(size)) == NULL) {
 		malloc_error(tracenum, i, "mm_malloc failed.");
 		return 0;
 	    }
@@ -633,7 +1003,7 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    
 	    /* Call the student's realloc */
 	    oldp = trace->blocks[index];
-	    if ((newp = mm_realloc(oldp, size)) == NULL) {
+	    if ((newp = alloc->realloc(oldp, size)) == NULL) {
 		malloc_error(tracenum, i, "mm_realloc failed.");
 		return 0;
 	    }
@@ -671,7 +1041,7 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    /* Remove region from list and call student's free function */
 	    p = trace->blocks[index];
 	    remove_range(ranges, p);
-	    mm_free(p);
+	    alloc->free(p);
 	    break;
 
 	default:
@@ -705,9 +1075,12 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
     char *p;
     char *newp, *oldp;
 
+    /* Utilization is only defined for packages that use memlib's heap */
+    if (!alloc->uses_memlib)
+	return 0;
+
     /* initialize the heap and the mm malloc package */
-    mem_reset_brk();
-    if (mm_init() < 0)
+    if (alloc->init() < 0)
 	app_error("mm_init failed in eval_mm_util");
 
     for (i = 0;  i < trace->num_ops;  i++) {
@@ -717,7 +1090,7 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    index = trace->ops[i].index;
 	    size = trace->ops[i].size;
 
-	    if ((p = mm_malloc(size)) == NULL) 
+	    if ((p = alloc->malloc(size)) == NULL) 
 		app_error("mm_malloc failed in eval_mm_util");
 	    
 	    /* Remember region and size */
@@ -739,7 +1112,7 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    oldsize = trace->block_sizes[index];
 
 	    oldp = trace->blocks[index];
-	    if ((newp = mm_realloc(oldp,newsize)) == NULL)
+	    if ((newp = alloc->realloc(oldp,newsize)) == NULL)
 		app_error("mm_realloc failed in eval_mm_util");
 
 	    /* Remember region and size */
@@ -760,7 +1133,7 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    size = trace->block_sizes[index];
 	    p = trace->blocks[index];
 	    
-	    mm_free(p);
+	    alloc->free(p);
 	    
 	    /* Keep track of current total size
 	     * of all allocated blocks */
@@ -778,6 +1151,104 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 }
 
 
+#if MM_WASTE_STATS
+/*
+ * eval_mm_waste - Account for every byte of the heap that is not live
+ *    payload at the peak that eval_mm_util measures. The trace is
+ *    replayed up to its first peak, where the package attributes the
+ *    unused bytes of each live block to headers, alignment or unsplit
+ *    remainders and reports its free blocks; the rest of the trace then
+ *    shows how much the heap still grows.
+ */
+static void eval_mm_waste(trace_t *trace, int tracenum, waste_t *waste)
+{
+    int i, index, size;
+    int total_size = 0, max_total_size = 0, peak = -1;
+    double peak_heap = 0;
+    char *p;
+    blockwaste_t bw;
+    heapstats_t hs;
+
+    /* The peak depends on the trace alone */
+    for (i = 0;  i < trace->num_ops;  i++) {
+	index = trace->ops[i].index;
+	if (trace->ops[i].type == FREE)
+	    total_size -= trace->block_sizes[index];
+	else {
+	    if (trace->ops[i].type == REALLOC)
+		total_size -= trace->block_sizes[index];
+	    total_size += (trace->block_sizes[index] = trace->ops[i].size);
+	    if (total_size > max_total_size) {
+		max_total_size = total_size;
+		peak = i;
+	    }
+	}
+    }
+
+    memset(waste, 0, sizeof(waste_t));
+    memset(trace->blocks, 0, trace->num_ids * sizeof(char *));
+    if (alloc->init() < 0)
+	app_error("mm_init failed in eval_mm_waste");
+
+    for (i = 0;  i < trace->num_ops;  i++) {
+	index = trace->ops[i].index;
+        switch (trace->ops[i].type) {
+
+        case ALLOC: /* mm_malloc */
+            size = trace->ops[i].size;
+            if ((p = alloc->malloc(size)) == NULL)
+		app_error("mm_malloc error in eval_mm_waste");
+            trace->blocks[index] = p;
+	    trace->block_sizes[index] = size;
+            break;
+
+	case REALLOC: /* mm_realloc */
+            size = trace->ops[i].size;
+            if ((p = alloc->realloc(trace->blocks[index], size)) == NULL)
+		app_error("mm_realloc error in eval_mm_waste");
+            trace->blocks[index] = p;
+	    trace->block_sizes[index] = size;
+            break;
+
+        case FREE: /* mm_free */
+            alloc->free(trace->blocks[index]);
+	    trace->blocks[index] = NULL;
+            break;
+
+	default:
+	    app_error("Nonexistent request type in eval_mm_waste");
+        }
+
+	if (i != peak)
+	    continue;
+
+	/* Take the heap apart at the peak */
+	memset(&bw, 0, sizeof(bw));
+	for (index = 0; index < trace->num_ids; index++) {
+	    if (trace->blocks[index] == NULL)
+		continue;
+	    alloc->blockwaste(trace->blocks[index], 
+			      trace->block_sizes[index], &bw);
+	    waste->payload += trace->block_sizes[index];
+	}
+	waste->overhead = bw.overhead;
+	waste->align = bw.align;
+	waste->unsplit = bw.unsplit;
+	if (alloc->heapstats) {
+	    alloc->heapstats(&hs);
+	    waste->free = hs.free_bytes;
+	}
+	peak_heap = mem_heapsize();
+	waste->other = peak_heap - waste->payload - waste->overhead -
+	    waste->align - waste->unsplit - waste->free;
+    }
+
+    waste->heap = mem_heapsize();
+    if (peak >= 0)
+	waste->growth = waste->heap - peak_heap;
+}
+#endif
+
 /*
  * eval_mm_speed - This is the function that is used by fcyc()
  *    to measure the running time of the mm malloc package.
@@ -788,19 +1259,29 @@ static void eval_mm_speed(void *ptr)
     char *p, *newp, *oldp, *block;
     trace_t *trace = ((speed_t *)ptr)->trace;
 
-    /* Reset the heap and initialize the mm package */
-    mem_reset_brk();
-    if (mm_init() < 0) 
+    /* Reset the heap and initialize the mm package, or restore both */
+    if (heap_reset != RESET_INIT && alloc->restore) {
+	if (heap_reset == RESET_CLEAN) {
+	    fsecs_pause();
+	    mem_flush();
+	    fsecs_resume();
+	}
+	if (alloc->restore() < 0)
+	    app_error("mm_restore failed in eval_mm_speed");
+    }
+    else if (alloc->init() < 0) 
 	app_error("mm_init failed in eval_mm_speed");
 
     /* Interpret each trace request */
-    for (i = 0;  i < trace->num_ops;  i++)
+    for (i = 0;  i < trace->num_ops;  i++) {
+	if (pollute_ops && i % pollute_ops == pollute_ops - 1)
+	    pollute_cache();
         switch (trace->ops[i].type) {
 
         case ALLOC: /* mm_malloc */
             index = trace->ops[i].index;
             size = trace->ops[i].size;
-            if ((p = mm_malloc(size)) == NULL)
+            if ((p = alloc->malloc(size)) == NULL)
 		app_error("mm_malloc error in eval_mm_speed");
             trace->blocks[index] = p;
             break;
@@ -809,7 +1290,7 @@ static void eval_mm_speed(void *ptr)
 	    index = trace->ops[i].index;
             newsize = trace->ops[i].size;
 	    oldp = trace->blocks[index];
-            if ((newp = mm_realloc(oldp,newsize)) == NULL)
+            if ((newp = alloc->realloc(oldp,newsize)) == NULL)
 		app_error("mm_realloc error in eval_mm_speed");
             trace->blocks[index] = newp;
             break;
@@ -817,99 +1298,674 @@ static void eval_mm_speed(void *ptr)
         case FREE: /* mm_free */
             index = trace->ops[i].index;
             block = trace->blocks[index];
-            mm_free(block);
+            alloc->free(block);
             break;
 
 	default:
 	    app_error("Nonexistent request type in eval_mm_valid");
         }
+    }
 }
 
 /*
- * eval_libc_valid - We run this function to make sure that the
- *    libc malloc can run to completion on the set of traces.
- *    We'll be conservative and terminate if any libc malloc call fails.
- *
+ * eval_mm_trace - Evaluate the correctness, space utilization and
+ *    speed of the mm package on one trace file
  */
-static int eval_libc_valid(trace_t *trace, int tracenum)
+static void eval_mm_trace(char *tracefile, int tracenum, stats_t *stats)
 {
-    int i, newsize;
-    char *p, *newp, *oldp;
+    trace_t *trace;
+    range_t *ranges = NULL;
+    speed_t speed_params;
+    double secs, sum = 0, sumsq = 0, mean;
+    int e, r;
+
+    trace = read_trace(tracedir, tracefile);
+    stats->ops = trace->num_ops;
+    if (verbose > 1)
+	printf("Checking mm_malloc for correctness, ");
+    stats->valid = eval_mm_valid(trace, tracenum, &ranges);
+    if (stats->valid) {
+	if (verbose > 1)
+	    printf("efficiency, ");
+	stats->util = eval_mm_util(trace, tracenum, &ranges);
+#if MM_WASTE_STATS
+	if (alloc->blockwaste)
+	    eval_mm_waste(trace, tracenum, &stats->waste);
+#endif
+	speed_params.trace = trace;
+	speed_params.ranges = ranges;
+	if (verbose > 1)
+	    printf("and performance.\n");
+	/* Timing runs restore this fresh heap instead of building one */
+	if (heap_reset != RESET_INIT && alloc->snapshot) {
+	    if (alloc->init() < 0)
+		app_error("mm_init failed in eval_mm_trace");
+	    if (heap_reset == RESET_CLEAN)
+		mem_prefault();
+	    alloc->snapshot();
+	}
+	/* Keep the fastest of nrepeat measurements and note the spread */
+	perf_clear();
+	perf_runs = 0;
+	for (r = 0; r < nrepeat; r++) {
+	    if (perfctr)
+		secs = fsecs(eval_mm_speed_perf, &speed_params);
+	    else
+		secs = fsecs(eval_mm_speed, &speed_params);
+	    if (r == 0 || secs < stats->secs)
+		stats->secs = secs;
+	    sum += secs;
+	    sumsq += secs * secs;
+	}
+	mean = sum / nrepeat;
+	if (nrepeat > 1 && mean > 0)
+	    stats->noise = sqrt(fmax(0, sumsq / nrepeat - mean * mean)) / mean;
+
+	if (perfctr) {
+	    for (e = 0; e < PERF_NEVENTS; e++) {
+		if (perf_count(e) < 0)
+		    stats->perf[e] = -1;
+		else
+		    stats->perf[e] = perf_count(e) / (perf_runs * stats->ops);
+	    }
+	}
+	if (latency)
+	    eval_mm_latency(trace, tracenum);
+
+	/* Time the trace again, this time with the application's accesses */
+	if (touch_pct) {
+	    speed_params.live = malloc(trace->num_ids * sizeof(int));
+	    speed_params.livepos = malloc(trace->num_ids * sizeof(int));
+	    if (!speed_params.live || !speed_params.livepos)
+		unix_error("malloc failed in eval_mm_trace");
+	    stats->touch_secs = fsecs(eval_mm_speed_touch, &speed_params);
+	    free(speed_params.live);
+	    free(speed_params.livepos);
+	}
+    }
+    clear_ranges(&ranges);
+    free_trace(trace);
+}
+
+/*
+ * eval_mm_parallel - Evaluate the traces in worker processes, at most
+ *    njobs at a time. Each worker is pinned to its own CPU, works on
+ *    its own copy of the memlib heap (fork copies it), and sends its
+ *    stats back to us over a pipe.
+ */
+static void eval_mm_parallel(char **tracefiles, int num_tracefiles,
+			     stats_t *stats, int njobs)
+{
+    pid_t *pids;     /* worker running in each slot, or 0 */
+    int *fds;        /* read end of the pipe from each slot's worker */
+    int *tracenums;  /* trace being evaluated in each slot */
+    int next = 0, running = 0;
+    int slot, status, pipefd[2];
+    long ncpus;
+    pid_t pid;
+    result_t result;
+
+    if ((pids = (pid_t *)calloc(njobs, sizeof(pid_t))) == NULL ||
+	(fds = (int *)calloc(njobs, sizeof(int))) == NULL ||
+	(tracenums = (int *)calloc(njobs, sizeof(int))) == NULL)
+	unix_error("calloc failed in eval_mm_parallel");
+    if ((ncpus = sysconf(_SC_NPROCESSORS_ONLN)) < 1)
+	ncpus = 1;
+
+    while (next < num_tracefiles || running > 0) {
+
+	/* Start workers in all of the free slots */
+	for (slot = 0; slot < njobs && next < num_tracefiles; slot++) {
+	    if (pids[slot] != 0)
+		continue;
+	    if (pipe(pipefd) < 0)
+		unix_error("pipe failed in eval_mm_parallel");
+	    fflush(stdout);
+	    if ((pid = fork()) < 0)
+		unix_error("fork failed in eval_mm_parallel");
+
+	    if (pid == 0) { /* Worker */
+		close(pipefd[0]);
+		pin_cpu(slot % ncpus);
+		if (perfctr)
+		    perf_init(); /* the parent's counters follow the parent */
+		errors = 0;
+		memset(&result, 0, sizeof(result));
+		eval_mm_trace(tracefiles[next], next, &result.stats);
+		result.errors = errors;
+		fflush(stdout);
+		if (write(pipefd[1], &result, sizeof(result)) != sizeof(result))
+		    exit(1);
+		exit(0);
+	    }
+
+	    close(pipefd[1]);
+	    pids[slot] = pid;
+	    fds[slot] = pipefd[0];
+	    tracenums[slot] = next++;
+	    running++;
+	}
+
+	/* Collect the next worker to finish */
+	if ((pid = wait(&status)) < 0)
+	    unix_error("wait failed in eval_mm_parallel");
+	for (slot = 0; slot < njobs && pids[slot] != pid; slot++)
+	    ;
+	if (slot == njobs)
+	    continue;
+	if (read(fds[slot], &result, sizeof(result)) != sizeof(result)) {
+	    sprintf(msg, "worker for trace %d died", tracenums[slot]);
+	    malloc_error(tracenums[slot], 0, msg);
+	    memset(&result.stats, 0, sizeof(stats_t));
+	    result.errors = 0;
+	}
+	stats[tracenums[slot]] = result.stats;
+	errors += result.errors;
+	close(fds[slot]);
+	pids[slot] = 0;
+	running--;
+    }
+
+    free(pids);
+    free(fds);
+    free(tracenums);
+}
+
+/*
+ * pin_cpu - Run the calling process on cpu only
+ */
+static void pin_cpu(int cpu)
+{
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) < 0 && verbose > 1)
+	printf("Could not pin worker to CPU %d: %s\n", cpu, strerror(errno));
+}
+
+/*
+ * eval_mm_speed_perf - eval_mm_speed, with the hardware counters
+ *    running over exactly the region that fsecs times.
+ */
+static void eval_mm_speed_perf(void *ptr)
+{
+    perf_start();
+    eval_mm_speed(ptr);
+    perf_stop();
+    perf_runs++;
+}
+
+/*
+ * eval_mm_speed_touch - Like eval_mm_speed, but also access the
+ *    payloads the way a program would: every block is written when it
+ *    is allocated or reallocated, and after each request touch_pct
+ *    percent of the live blocks are read and updated, picked at random
+ *    or (touch_seq) in id order, i.e., roughly the order they were
+ *    allocated in. Where the package places blocks then shows up as
+ *    cache and TLB misses in the application's accesses.
+ */
+static void eval_mm_speed_touch(void *ptr)
+{
+    speed_t *params = (speed_t *)ptr;
+    trace_t *trace = params->trace;
+    int *live = params->live;
+    int *livepos = params->livepos;
+    int i, j, n, index, size;
+    int nlive = 0, cursor = 0;
+    unsigned int seed = 1;
+    char *p;
+
+    /* Reset the heap and initialize the mm package */
+    if (alloc->init() < 0) 
+	app_error("mm_init failed in eval_mm_speed_touch");
+    memset(trace->blocks, 0, trace->num_ids * sizeof(char *));
 
     for (i = 0;  i < trace->num_ops;  i++) {
+	index = trace->ops[i].index;
         switch (trace->ops[i].type) {
 
-        case ALLOC: /* malloc */
-	    if ((p = malloc(trace->ops[i].size)) == NULL) {
-		malloc_error(tracenum, i, "libc malloc failed");
-		unix_error("System message");
-	    }
-	    trace->blocks[trace->ops[i].index] = p;
-	    break;
+        case ALLOC: /* mm_malloc */
+            size = trace->ops[i].size;
+            if ((p = alloc->malloc(size)) == NULL)
+		app_error("mm_malloc error in eval_mm_speed_touch");
+            trace->blocks[index] = p;
+	    trace->block_sizes[index] = size;
+	    livepos[index] = nlive;
+	    live[nlive++] = index;
+	    touch_block(p, size);
+            break;
 
-	case REALLOC: /* realloc */
-            newsize = trace->ops[i].size;
-	    oldp = trace->blocks[trace->ops[i].index];
-	    if ((newp = realloc(oldp, newsize)) == NULL) {
-		malloc_error(tracenum, i, "libc realloc failed");
-		unix_error("System message");
-	    }
-	    trace->blocks[trace->ops[i].index] = newp;
-	    break;
-	    
-        case FREE: /* free */
-	    free(trace->blocks[trace->ops[i].index]);
-	    break;
+	case REALLOC: /* mm_realloc */
+            size = trace->ops[i].size;
+            if ((p = alloc->realloc(trace->blocks[index], size)) == NULL)
+		app_error("mm_realloc error in eval_mm_speed_touch");
+            trace->blocks[index] = p;
+	    trace->block_sizes[index] = size;
+	    touch_block(p, size);
+            break;
+
+        case FREE: /* mm_free */
+            alloc->free(trace->blocks[index]);
+	    trace->blocks[index] = NULL;
+	    j = livepos[index];
+	    live[j] = live[--nlive];
+	    livepos[live[j]] = j;
+            break;
 
 	default:
-	    app_error("invalid operation type  in eval_libc_valid");
+	    app_error("Nonexistent request type in eval_mm_speed_touch");
+        }
+
+	/* The application works on some of its blocks until the next request */
+	for (n = (nlive * touch_pct + 99) / 100; n > 0; n--) {
+	    if (touch_seq) {
+		do
+		    cursor = (cursor + 1) % trace->num_ids;
+		while (trace->blocks[cursor] == NULL);
+		index = cursor;
+	    }
+	    else {
+		seed = seed * 1103515245 + 12345;
+		index = live[(seed >> 8) % nlive];
+	    }
+	    touch_block(trace->blocks[index], trace->block_sizes[index]);
 	}
     }
-
-    return 1;
 }
 
-/* 
- * eval_libc_speed - This is the function that is used by fcyc() to
- *    measure the running time of the libc malloc package on the set
- *    of traces.
+/*
+ * touch_block - Read and update one byte in each line of a payload
  */
-static void eval_libc_speed(void *ptr)
+static void touch_block(char *p, int size)
 {
     int i;
-    int index, size, newsize;
-    char *p, *newp, *oldp, *block;
-    trace_t *trace = ((speed_t *)ptr)->trace;
 
+    for (i = 0; i < size; i += TOUCH_LINE)
+	p[i]++;
+}
+
+/*
+ * pollute_cache - Evict the allocator's data between batches of
+ *    requests, as the rest of a real program would (-C polluted). The
+ *    timer and the hardware counters are stopped meanwhile.
+ */
+static void pollute_cache(void)
+{
+    if (perfctr)
+	perf_stop();
+    fsecs_pollute();
+    if (perfctr)
+	perf_start();
+}
+
+/*
+ * lat_class - Return the latency size class of a size byte request
+ */
+static int lat_class(int size)
+{
+    int c = 0;
+
+    while (size > lat_class_max[c])
+	c++;
+    return c;
+}
+
+/*
+ * eval_mm_latency - Replay the trace once, timing each request on its
+ *    own with the cycle counter, and print latency percentiles per
+ *    request type and size class. Frees are classed by the size of
+ *    the block being freed. The cost of reading the counter is
+ *    subtracted from every sample.
+ */
+static void eval_mm_latency(trace_t *trace, int tracenum)
+{
+    static lathist_t hists[3][LAT_CLASSES+1];
+    int i, j, t, c, index, size;
+    char *p, *newp, *oldp;
+    lh_val_t ovhd, start, lat;
+    lathist_t *h;
+
+    for (t = 0; t < 3; t++)
+	for (c = 0; c <= LAT_CLASSES; c++)
+	    lh_reset(&hists[t][c]);
+    ovhd = lh_overhead();
+
+    /* Reset the heap and initialize the mm package */
+    if (alloc->init() < 0) 
+	app_error("mm_init failed in eval_mm_latency");
+
+    /* Interpret and time each trace request */
+    fsecs_pollute();
     for (i = 0;  i < trace->num_ops;  i++) {
+	if (pollute_ops && i % pollute_ops == pollute_ops - 1)
+	    fsecs_pollute();
+	index = trace->ops[i].index;
         switch (trace->ops[i].type) {
-        case ALLOC: /* malloc */
-	    index = trace->ops[i].index;
-	    size = trace->ops[i].size;
-	    if ((p = malloc(size)) == NULL)
-		unix_error("malloc failed in eval_libc_speed");
-	    trace->blocks[index] = p;
-	    break;
 
-	case REALLOC: /* realloc */
-	    index = trace->ops[i].index;
-	    newsize = trace->ops[i].size;
+        case ALLOC: /* mm_malloc */
+            size = trace->ops[i].size;
+	    start = lh_now();
+	    p = alloc->malloc(size);
+	    lat = lh_now() - start;
+            if (p == NULL)
+		app_error("mm_malloc error in eval_mm_latency");
+            trace->blocks[index] = p;
+	    trace->block_sizes[index] = size;
+            break;
+
+	case REALLOC: /* mm_realloc */
+            size = trace->ops[i].size;
 	    oldp = trace->blocks[index];
-	    if ((newp = realloc(oldp, newsize)) == NULL)
-		unix_error("realloc failed in eval_libc_speed\n");
-	    
-	    trace->blocks[index] = newp;
-	    break;
-	    
-        case FREE: /* free */
-	    index = trace->ops[i].index;
-	    block = trace->blocks[index];
-	    free(block);
-	    break;
+	    start = lh_now();
+	    newp = alloc->realloc(oldp, size);
+	    lat = lh_now() - start;
+            if (newp == NULL)
+		app_error("mm_realloc error in eval_mm_latency");
+            trace->blocks[index] = newp;
+	    trace->block_sizes[index] = size;
+            break;
+
+        case FREE: /* mm_free */
+	    size = trace->block_sizes[index];
+	    p = trace->blocks[index];
+	    start = lh_now();
+            alloc->free(p);
+	    lat = lh_now() - start;
+            break;
+
+	default:
+	    app_error("Nonexistent request type in eval_mm_latency");
+	    return;
+        }
+
+	lat = (lat > ovhd) ? lat - ovhd : 0;
+	t = trace->ops[i].type;
+	lh_record(&hists[t][lat_class(size)], lat, i);
+	lh_record(&hists[t][LAT_CLASSES], lat, i);
+    }
+
+    /* Print the nonempty histograms */
+    printf("\nLatency for trace %d in cycles (%llu cycle timer overhead "
+	   "subtracted):\n", tracenum, ovhd);
+    printf("%-8s%-8s%8s%8s%8s%8s%10s  %s\n",
+	   "op", "size", "ops", "p50", "p99", "p99.9", "max", "worst ops");
+    for (t = 0; t < 3; t++) {
+	for (c = 0; c <= LAT_CLASSES; c++) {
+	    h = &hists[t][c];
+	    if (h->total == 0)
+		continue;
+	    printf("%-8s%-8s%8llu%8llu%8llu%8llu%10llu ",
+		   lat_op_names[t], lat_class_names[c], h->total,
+		   lh_percentile(h, 0.50), lh_percentile(h, 0.99),
+		   lh_percentile(h, 0.999), h->max);
+	    for (j = 0; j < h->nworst; j++)
+		printf(" %d", h->worst_op[j]);
+	    printf("\n");
 	}
     }
 }
 
+/*
+ * eval_mm_timeline - Replay a trace and, every interval ops and after
+ *    the last one, write the live payload, the heap size and the
+ *    package's free space statistics to fp as one CSV row. Unlike the
+ *    single utilization figure, this shows when fragmentation builds up
+ *    and which size classes hold the free space.
+ */
+static void eval_mm_timeline(FILE *fp, char *tracefile, int tracenum,
+			     int interval)
+{
+    trace_t *trace;
+    int i, index, size;
+    int live = 0;
+    char *p;
+
+    trace = read_trace(tracedir, tracefile);
+    if (alloc->init() < 0) 
+	app_error("mm_init failed in eval_mm_timeline");
+
+    for (i = 0;  i < trace->num_ops;  i++) {
+	index = trace->ops[i].index;
+        switch (trace->ops[i].type) {
+
+        case ALLOC: /* mm_malloc */
+            size = trace->ops[i].size;
+            if ((p = alloc->malloc(size)) == NULL)
+		app_error("mm_malloc error in eval_mm_timeline");
+            trace->blocks[index] = p;
+	    trace->block_sizes[index] = size;
+	    live += size;
+            break;
+
+	case REALLOC: /* mm_realloc */
+            size = trace->ops[i].size;
+            if ((p = alloc->realloc(trace->blocks[index], size)) == NULL)
+		app_error("mm_realloc error in eval_mm_timeline");
+            trace->blocks[index] = p;
+	    live += size - trace->block_sizes[index];
+	    trace->block_sizes[index] = size;
+            break;
+
+        case FREE: /* mm_free */
+            alloc->free(trace->blocks[index]);
+	    live -= trace->block_sizes[index];
+            break;
+
+	default:
+	    app_error("Nonexistent request type in eval_mm_timeline");
+        }
+
+	if ((i + 1) % interval == 0 || i == trace->num_ops - 1)
+	    timeline_sample(fp, tracenum, i + 1, live);
+    }
+    free_trace(trace);
+}
+
+/*
+ * timeline_sample - Write one row of the fragmentation timeline, and
+ *    the column names before the first one
+ */
+static void timeline_sample(FILE *fp, int tracenum, int opnum, int live)
+{
+    static int header = 0;
+    heapstats_t hs;
+    int c;
+
+    alloc->heapstats(&hs);
+    if (!header) {
+	fprintf(fp, "allocator,trace,op,live,heap,free,largest,nfree");
+	for (c = 0; c < hs.nclasses; c++)
+	    fprintf(fp, ",class%d", c);
+	fprintf(fp, "\n");
+	header = 1;
+    }
+    fprintf(fp, "%s,%d,%d,%d,%lu,%lu,%lu,%d", alloc->name, tracenum, opnum,
+	    live, (unsigned long)mem_heapsize(), (unsigned long)hs.free_bytes,
+	    (unsigned long)hs.largest_free, hs.free_blocks);
+    for (c = 0; c < hs.nclasses; c++)
+	fprintf(fp, ",%lu", (unsigned long)hs.class_bytes[c]);
+    fprintf(fp, "\n");
+}
+
+/*
+ * eval_mm_threads - Replay traces concurrently on nthreads threads.
+ *    With a single trace file, each thread replays one shard of it (the
+ *    requests for every nthreads-th block id); otherwise thread k replays
+ *    trace k modulo the number of traces. The same work is then done on
+ *    a single thread, which gives the scaling efficiency
+ *    thruput(n) / (n * thruput(1)). Each configuration is run three
+ *    times and the fastest run is reported, with each thread's time in it.
+ */
+static void eval_mm_threads(char **tracefiles, int num_tracefiles, 
+			    int nthreads)
+{
+    trace_t **traces;
+    mt_work_t *work;
+    int i, k, run, nloaded, ops = 0;
+    double secs, best_n = DBL_MAX, best_1 = DBL_MAX;
+    double *thread_secs; /* each thread's time in the fastest run */
+
+    /* A shard or trace per thread */
+    nloaded = (nthreads < num_tracefiles) ? nthreads : num_tracefiles;
+    if ((traces = (trace_t **)calloc(nloaded, sizeof(trace_t *))) == NULL ||
+	(work = (mt_work_t *)calloc(nthreads, sizeof(mt_work_t))) == NULL ||
+	(thread_secs = (double *)calloc(nthreads, sizeof(double))) == NULL)
+	unix_error("calloc failed in eval_mm_threads");
+    for (i = 0; i < nloaded; i++)
+	traces[i] = read_trace(tracedir, tracefiles[i]);
+    for (k = 0; k < nthreads; k++) {
+	work[k].trace = traces[k % nloaded];
+	work[k].shard = (num_tracefiles == 1) ? k : 0;
+	work[k].nshards = (num_tracefiles == 1) ? nthreads : 1;
+	work[k].blocks = (char **)calloc(work[k].trace->num_ids, sizeof(char *));
+	if (work[k].blocks == NULL)
+	    unix_error("calloc failed in eval_mm_threads");
+    }
+
+    /* Concurrently, then sequentially */
+    for (run = 0; run < 3; run++) {
+	if ((secs = mt_run(work, nthreads, nthreads)) < best_n) {
+	    best_n = secs;
+	    for (k = 0; k < nthreads; k++)
+		thread_secs[k] = work[k].end - work[k].start;
+	}
+    }
+    printf("\nReplay on %d threads (%s):\n", nthreads, 
+	   (num_tracefiles == 1) ? "one shard of the trace each" : 
+	   "one trace each");
+    printf("%6s%6s%8s%10s%8s\n", "thread", "trace", "ops", "secs", "Kops");
+    for (k = 0; k < nthreads; k++) {
+	secs = thread_secs[k];
+	ops += work[k].ops;
+	printf("%6d%6d%8d%10.6f%8.0f\n", k, k % nloaded, work[k].ops, secs,
+	       (work[k].ops/1e3)/secs);
+    }
+    for (run = 0; run < 3; run++) {
+	if ((secs = mt_run(work, nthreads, 1)) < best_1)
+	    best_1 = secs;
+    }
+    printf("Aggregate: %.0f Kops on %d threads, %.0f Kops on 1 thread, "
+	   "scaling efficiency %.0f%%\n", (ops/1e3)/best_n, nthreads, 
+	   (ops/1e3)/best_1, 100.0 * best_1 / (nthreads * best_n));
+
+    for (k = 0; k < nthreads; k++)
+	free(work[k].blocks);
+    for (i = 0; i < nloaded; i++)
+	free_trace(traces[i]);
+    free(thread_secs);
+    free(work);
+    free(traces);
+}
+
+/*
+ * mt_run - Do the nwork units of work on nthreads threads (1 or nwork)
+ *    against a freshly initialized heap, and return the elapsed time
+ */
+static double mt_run(mt_work_t *work, int nwork, int nthreads)
+{
+    pthread_t *tids;
+    double start, end;
+    int k;
+
+    if (alloc->init() < 0)
+	app_error("mm_init failed in mt_run");
+
+    if (nthreads == 1) {
+	for (k = 0; k < nwork; k++)
+	    mt_replay(&work[k]);
+    }
+    else {
+	if ((tids = (pthread_t *)malloc(nthreads * sizeof(pthread_t))) == NULL)
+	    unix_error("malloc failed in mt_run");
+	pthread_barrier_init(&mt_barrier, NULL, nthreads);
+	for (k = 0; k < nthreads; k++)
+	    if (pthread_create(&tids[k], NULL, mt_thread, &work[k]) != 0)
+		unix_error("pthread_create failed in mt_run");
+	for (k = 0; k < nthreads; k++)
+	    pthread_join(tids[k], NULL);
+	pthread_barrier_destroy(&mt_barrier);
+	free(tids);
+    }
+
+    /* From the first start to the last finish */
+    start = work[0].start;
+    end = work[0].end;
+    for (k = 1; k < nwork; k++) {
+	start = (work[k].start < start) ? work[k].start : start;
+	end = (work[k].end > end) ? work[k].end : end;
+    }
+    return end - start;
+}
+
+/*
+ * mt_thread - Thread routine: wait for the others, then replay
+ */
+static void *mt_thread(void *vargp)
+{
+    pthread_barrier_wait(&mt_barrier);
+    mt_replay((mt_work_t *)vargp);
+    return NULL;
+}
+
+/*
+ * mt_now - Return the monotonic clock in seconds
+ */
+static double mt_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * mt_replay - Replay one unit of work, timing it
+ */
+static void mt_replay(mt_work_t *w)
+{
+    trace_t *trace = w->trace;
+    int i, index;
+    char *p;
+
+    w->ops = 0;
+    w->start = mt_now();
+    for (i = 0;  i < trace->num_ops;  i++) {
+	index = trace->ops[i].index;
+	if (index % w->nshards != w->shard)
+	    continue;
+	w->ops++;
+
+	if (!alloc->threadsafe)
+	    pthread_mutex_lock(&mt_lock);
+        switch (trace->ops[i].type) {
+
+        case ALLOC: /* mm_malloc */
+            p = alloc->malloc(trace->ops[i].size);
+            break;
+
+	case REALLOC: /* mm_realloc */
+            p = alloc->realloc(w->blocks[index], trace->ops[i].size);
+            break;
+
+        case FREE: /* mm_free */
+            alloc->free(w->blocks[index]);
+	    p = w->blocks[index];
+            break;
+
+	default:
+	    p = NULL;
+        }
+	if (!alloc->threadsafe)
+	    pthread_mutex_unlock(&mt_lock);
+
+	if (p == NULL)
+	    app_error("mm_malloc or mm_realloc error in mt_replay");
+	w->blocks[index] = p;
+    }
+    w->end = mt_now();
+}
+
 /*************************************
  * Some miscellaneous helper routines
  ************************************/
@@ -972,6 +2028,342 @@ static void printresults(int n, stats_t *stats)
 
 }
 
+#if MM_WASTE_STATS
+/*
+ * printwaste - prints where each trace's heap went, in percent of the
+ *    final heap. The columns add up to 100.
+ */
+static void printwaste(int n, stats_t *stats)
+{
+    int i;
+    waste_t *w;
+
+    printf("%5s%9s%9s%9s%9s%9s%9s%9s\n", "trace", "payload", "hdr/ftr",
+	   "align", "unsplit", "free", "growth", "other");
+    for (i = 0; i < n; i++) {
+	w = &stats[i].waste;
+	if (!stats[i].valid || w->heap == 0) {
+	    printf("%2d%10s\n", i, "-");
+	    continue;
+	}
+	printf("%2d%11.1f%9.1f%9.1f%9.1f%9.1f%9.1f%9.1f\n", i,
+	       100.0 * w->payload / w->heap, 100.0 * w->overhead / w->heap,
+	       100.0 * w->align / w->heap, 100.0 * w->unsplit / w->heap,
+	       100.0 * w->free / w->heap, 100.0 * w->growth / w->heap,
+	       100.0 * w->other / w->heap);
+    }
+}
+#endif
+
+/*
+ * printtouch - prints the speed of each trace with and without the
+ *    payload accesses of --touch
+ */
+static void printtouch(int n, stats_t *stats)
+{
+    int i;
+
+    printf("%5s%10s%10s%10s%10s%8s\n", "trace", "secs", "touched", "Kops",
+	   "touched", "ratio");
+    for (i = 0; i < n; i++) {
+	if (!stats[i].valid) {
+	    printf("%2d%11s\n", i, "-");
+	    continue;
+	}
+	printf("%2d%13.6f%10.6f%10.0f%10.0f%8.2f\n", i, stats[i].secs,
+	       stats[i].touch_secs, (stats[i].ops/1e3)/stats[i].secs,
+	       (stats[i].ops/1e3)/stats[i].touch_secs,
+	       stats[i].touch_secs / stats[i].secs);
+    }
+}
+
+/*
+ * printperf - prints the hardware events per op for each trace
+ */
+static void printperf(int n, stats_t *stats)
+{
+    int i, e;
+
+    printf("%5s", "trace");
+    for (e = 0; e < PERF_NEVENTS; e++) {
+	printf("%10s", perf_name(e));
+	if (e == PERF_INSNS)
+	    printf("%6s", "IPC");
+    }
+    printf("\n");
+
+    for (i = 0; i < n; i++) {
+	printf("%2d   ", i);
+	for (e = 0; e < PERF_NEVENTS; e++) {
+	    if (!stats[i].valid || stats[i].perf[e] < 0)
+		printf("%10s", "-");
+	    else
+		printf("%10.2f", stats[i].perf[e]);
+	    if (e == PERF_INSNS) {
+		if (!stats[i].valid || stats[i].perf[PERF_INSNS] < 0 ||
+		    stats[i].perf[PERF_CYCLES] <= 0)
+		    printf("%6s", "-");
+		else
+		    printf("%6.2f", stats[i].perf[PERF_INSNS] / 
+			   stats[i].perf[PERF_CYCLES]);
+	    }
+	}
+	printf("\n");
+    }
+}
+
+/*
+ * printcompare - prints the results of several packages side by side
+ */
+static void printcompare(int n, int nallocs, allocator_t **allocs,
+			 stats_t **stats)
+{
+    int i, a;
+
+    printf("Comparison:\n%5s", "trace");
+    for (a = 0; a < nallocs; a++)
+	printf("%8.8s%10s", allocs[a]->name, "Kops");
+    printf("\n");
+    for (i = 0; i < n; i++) {
+	printf("%2d   ", i);
+	for (a = 0; a < nallocs; a++) {
+	    if (!stats[a][i].valid)
+		printf("%8s%10s", "-", "-");
+	    else if (!allocs[a]->uses_memlib)
+		printf("%8s%10.0f", "-", 
+		       (stats[a][i].ops/1e3)/stats[a][i].secs);
+	    else
+		printf("%7.0f%%%10.0f", stats[a][i].util*100.0, 
+		       (stats[a][i].ops/1e3)/stats[a][i].secs);
+	}
+	printf("\n");
+    }
+}
+
+/*
+ * cpu_model - Return the CPU model name from /proc/cpuinfo
+ */
+static char *cpu_model(void)
+{
+    static char model[MAXLINE];
+    char line[MAXLINE];
+    char *p;
+    FILE *fp;
+
+    strcpy(model, "unknown");
+    if ((fp = fopen("/proc/cpuinfo", "r")) == NULL)
+	return model;
+    while (fgets(line, MAXLINE, fp) != NULL) {
+	if (!strncmp(line, "model name", 10) && (p = strchr(line, ':'))) {
+	    for (p++; *p == ' '; p++)
+		;
+	    p[strcspn(p, "\n")] = '\0';
+	    strcpy(model, p);
+	    break;
+	}
+    }
+    fclose(fp);
+    return model;
+}
+
+/*
+ * write_results - Write the per-trace stats of each package and a
+ *    description of the environment to filename, as JSON or (if csv is
+ *    set) CSV. The perf index is that of the first package. The JSON
+ *    has one line per trace, which is what compare_baseline expects.
+ */
+static void write_results(char *filename, int csv, char **tracefiles,
+			  int n, int nallocs, allocator_t **allocs, 
+			  stats_t **stats, double perfindex)
+{
+    FILE *fp;
+    int a, i, e;
+    double kops;
+    stats_t *st;
+
+    if ((fp = fopen(filename, "w")) == NULL) {
+	sprintf(msg, "Could not open %s in write_results", filename);
+	unix_error(msg);
+    }
+
+    if (csv) {
+	fprintf(fp, "# team: %s\n# cpu: %s\n# timer: %s\n# cache: %s\n"
+		"# search: %s\n# prefetch: %d\n# reset: %s\n# cflags: %s\n"
+		"# compiler: %s\n# perfindex: %.1f\n", team.teamname, 
+		cpu_model(), fsecs_timer_name(), fsecs_cache_name(), 
+		search_desc(), mm_prefetch, reset_names[heap_reset], BUILD_FLAGS, __VERSION__, 
+		perfindex);
+	fprintf(fp, "allocator,file,valid,ops,util,secs,kops,noise");
+	for (e = 0; perfctr && e < PERF_NEVENTS; e++)
+	    fprintf(fp, ",%s", perf_name(e));
+	if (touch_pct)
+	    fprintf(fp, ",touch_secs");
+	fprintf(fp, "\n");
+    }
+    else {
+	fprintf(fp, "{\n  \"team\": \"%s\",\n  \"cpu\": \"%s\",\n"
+		"  \"timer\": \"%s\",\n  \"cache\": \"%s\",\n"
+		"  \"search\": \"%s\",\n  \"prefetch\": %d,\n"
+		"  \"reset\": \"%s\",\n"
+		"  \"cflags\": \"%s\",\n  \"compiler\": \"%s\",\n"
+		"  \"perfindex\": %.1f,\n  \"traces\": [\n", team.teamname,
+		cpu_model(), fsecs_timer_name(), fsecs_cache_name(),
+		search_desc(), mm_prefetch, reset_names[heap_reset], BUILD_FLAGS, __VERSION__, 
+		perfindex);
+    }
+
+    for (a = 0; a < nallocs; a++) {
+	for (i = 0; i < n; i++) {
+	    st = &stats[a][i];
+	    kops = (st->valid && st->secs > 0) ? (st->ops/1e3)/st->secs : 0;
+	    if (csv) {
+		fprintf(fp, "%s,%s,%d,%.0f,%.6f,%.9f,%.3f,%.6f", 
+			allocs[a]->name, tracefiles[i], st->valid, st->ops,
+			st->util, st->secs, kops, st->noise);
+		for (e = 0; perfctr && e < PERF_NEVENTS; e++)
+		    fprintf(fp, ",%.4f", st->perf[e]);
+		if (touch_pct)
+		    fprintf(fp, ",%.9f", st->touch_secs);
+		fprintf(fp, "\n");
+	    }
+	    else {
+		fprintf(fp, "    {\"allocator\": \"%s\", \"file\": \"%s\", "
+			"\"valid\": %d, \"ops\": %.0f, \"util\": %.6f, "
+			"\"secs\": %.9f, \"kops\": %.3f, \"noise\": %.6f",
+			allocs[a]->name, tracefiles[i], st->valid, st->ops,
+			st->util, st->secs, kops, st->noise);
+		for (e = 0; perfctr && e < PERF_NEVENTS; e++)
+		    fprintf(fp, ", \"%s\": %.4f", perf_name(e), st->perf[e]);
+		if (touch_pct)
+		    fprintf(fp, ", \"touch_secs\": %.9f", st->touch_secs);
+		fprintf(fp, "}%s\n", (a < nallocs-1 || i < n-1) ? "," : "");
+	    }
+	}
+    }
+
+    if (!csv)
+	fprintf(fp, "  ]\n}\n");
+    fclose(fp);
+}
+
+/*
+ * json_field - Return a pointer to the value of "key" in line, or NULL
+ */
+static char *json_field(char *line, char *key)
+{
+    char pattern[MAXLINE];
+    char *p;
+
+    sprintf(pattern, "\"%s\":", key);
+    if ((p = strstr(line, pattern)) == NULL)
+	return NULL;
+    for (p += strlen(pattern); *p == ' '; p++)
+	;
+    return p;
+}
+
+/*
+ * read_baseline - Read the traces in a results file written by
+ *    write_results (JSON); returns the number of traces found
+ */
+static int read_baseline(char *filename, baseline_t **base)
+{
+    FILE *fp;
+    char line[MAXLINE];
+    char *p;
+    int n = 0, size = 0;
+
+    if ((fp = fopen(filename, "r")) == NULL) {
+	sprintf(msg, "Could not open %s in read_baseline", filename);
+	unix_error(msg);
+    }
+    *base = NULL;
+    while (fgets(line, MAXLINE, fp) != NULL) {
+	if ((p = json_field(line, "file")) == NULL)
+	    continue;
+	if (n == size) {
+	    size = size ? 2 * size : 16;
+	    if ((*base = realloc(*base, size * sizeof(baseline_t))) == NULL)
+		unix_error("realloc failed in read_baseline");
+	}
+	sscanf(p, "\"%[^\"]\"", (*base)[n].file);
+	strcpy((*base)[n].allocator, "mm");
+	if ((p = json_field(line, "allocator")) != NULL)
+	    sscanf(p, "\"%[^\"]\"", (*base)[n].allocator);
+	(*base)[n].valid = (p = json_field(line, "valid")) ? atoi(p) : 0;
+	(*base)[n].util = (p = json_field(line, "util")) ? atof(p) : 0;
+	(*base)[n].kops = (p = json_field(line, "kops")) ? atof(p) : 0;
+	(*base)[n].noise = (p = json_field(line, "noise")) ? atof(p) : 0;
+	n++;
+    }
+    fclose(fp);
+    return n;
+}
+
+/*
+ * compare_baseline - Compare this run of each package with its results
+ *    in filename and return 1 if any trace regressed. Throughput
+ *    regresses if it drops by more than tolerance, widened to twice the
+ *    combined noise of the two runs when that is larger. Utilization is
+ *    deterministic, so any drop of more than 0.1% counts.
+ */
+static int compare_baseline(char *filename, char **tracefiles, int n,
+			    int nallocs, allocator_t **allocs, 
+			    stats_t **stats, double tolerance)
+{
+    baseline_t *base;
+    int nbase, a, i, j, regressed = 0;
+    double kops, allowed, change;
+    char *status;
+    stats_t *st;
+
+    nbase = read_baseline(filename, &base);
+    for (a = 0; a < nallocs; a++) {
+	printf("\nComparison of %s malloc with %s:\n", allocs[a]->name,
+	       filename);
+	printf("%5s%7s%7s%10s%10s%8s%8s  %s\n", "trace", "util", "base",
+	       "Kops", "base", "change", "allowed", "status");
+	for (i = 0; i < n; i++) {
+	    st = &stats[a][i];
+	    for (j = 0; j < nbase; j++)
+		if (!strcmp(base[j].file, tracefiles[i]) &&
+		    !strcmp(base[j].allocator, allocs[a]->name))
+		    break;
+	    /* A baseline without a throughput cannot be compared with */
+	    if (j == nbase || !base[j].valid || !(base[j].kops > 0)) {
+		printf("%2d%47s  %s\n", i, "", "not in baseline");
+		continue;
+	    }
+	    if (!st->valid) {
+		printf("%2d%47s  %s\n", i, "", "REGRESSED (invalid)");
+		regressed = 1;
+		continue;
+	    }
+
+	    kops = (st->ops/1e3)/st->secs;
+	    change = (kops - base[j].kops) / base[j].kops;
+	    allowed = 2 * (st->noise + base[j].noise);
+	    allowed = (allowed > tolerance) ? allowed : tolerance;
+	    status = "ok";
+	    if (st->util < base[j].util - 0.001) {
+		status = "REGRESSED (util)";
+		regressed = 1;
+	    }
+	    else if (change < -allowed) {
+		status = "REGRESSED (thru)";
+		regressed = 1;
+	    }
+	    printf("%2d%9.1f%%%6.1f%%%10.0f%10.0f%7.1f%%%7.1f%%  %s\n", i,
+		   st->util*100.0, base[j].util*100.0, kops, base[j].kops,
+		   change*100.0, allowed*100.0, status);
+	}
+    }
+    printf("%s\n", regressed ? "Performance regressed." : 
+	   "No regressions.");
+    free(base);
+    return regressed;
+}
+
 /* 
  * app_error - Report an arbitrary application error
  */
@@ -999,19 +2391,63 @@ void malloc_error(int tracenum, int opnum, char *msg)
     printf("ERROR [trace %d, line %d]: %s\n", tracenum, LINENUM(opnum), msg);
 }
 
+/*
+ * search_desc - Describe mm.c's search policy, e.g., "good (budget 8,
+ *     slack 10%)"
+ */
+static char *search_desc(void)
+{
+    static char desc[MAXLINE];
+
+    if (search_policy == MM_SEARCH_GOOD)
+	sprintf(desc, "good (budget %d, slack %d%%)", search_budget, 
+		search_slack);
+    else
+	strcpy(desc, search_names[search_policy]);
+    return desc;
+}
+
 /* 
  * usage - Explain the command line arguments
  */
 static void usage(void) 
 {
-    fprintf(stderr, "Usage: mdriver [-hvVal] [-f <file>] [-t <dir>]\n");
+    int i;
+
+    fprintf(stderr, "Usage: mdriver [-hvValLP] [-f <file>] [-t <dir>] [-c <timer>] [-C <cache>] [-m <name>] [-j <n>] [-T <n>]\n");
     fprintf(stderr, "Options\n");
     fprintf(stderr, "\t-a         Don't check the team structure.\n");
+    fprintf(stderr, "\t-c <timer> Timer: fcyc, tsc, mono, itimer or gettod.\n");
+    fprintf(stderr, "\t-C <cache> Cache state when timing: cold (default), warm or polluted.\n");
     fprintf(stderr, "\t-f <file>  Use <file> as the trace file.\n");
     fprintf(stderr, "\t-g         Generate summary info for autograder.\n");
     fprintf(stderr, "\t-h         Print this message.\n");
-    fprintf(stderr, "\t-l         Run libc malloc as well.\n");
+    fprintf(stderr, "\t-j <n>     Evaluate up to n traces at once in worker processes.\n");
+    fprintf(stderr, "\t-l         Run libc malloc as well (same as -m libc).\n");
+    fprintf(stderr, "\t-L         Print per-request latency percentiles.\n");
+    fprintf(stderr, "\t-m <name>  Evaluate malloc package <name> (repeatable):\n");
+    for (i = 0; allocators[i] != NULL; i++)
+	fprintf(stderr, "\t             %-8s %s\n", allocators[i]->name,
+		allocators[i]->description);
+    fprintf(stderr, "\t-P         Print hardware performance counters per op.\n");
     fprintf(stderr, "\t-t <dir>   Directory to find default traces.\n");
+    fprintf(stderr, "\t-T <n>     Also replay on n threads and report scaling.\n");
     fprintf(stderr, "\t-v         Print per-trace performance breakdowns.\n");
     fprintf(stderr, "\t-V         Print additional debug info.\n");
+    fprintf(stderr, "\t--json <file>      Write per-trace results as JSON.\n");
+    fprintf(stderr, "\t--csv <file>       Write per-trace results as CSV.\n");
+    fprintf(stderr, "\t--baseline <file>  Compare with JSON results; exit 2 on regression.\n");
+    fprintf(stderr, "\t--repeat <n>       Repeat each speed measurement n times.\n");
+    fprintf(stderr, "\t--tolerance <pct>  Throughput loss allowed vs. baseline (default 5).\n");
+    fprintf(stderr, "\t--cache-kb <n>     Size of the cache flushing/polluting buffer (default 512).\n");
+    fprintf(stderr, "\t--pollute-ops <n>  Ops between cache pollutions (default 100).\n");
+    fprintf(stderr, "\t--touch <pct>      Also time the trace accessing pct%% of live blocks per op.\n");
+    fprintf(stderr, "\t--touch-order <o>  Pick the blocks to access at random (default) or in seq order.\n");
+    fprintf(stderr, "\t--search <policy>  Fit search in mm.c: first (default), next, best or good.\n");
+    fprintf(stderr, "\t--search-budget <k> Good fit: look at no more than k fitting blocks (default 8)...\n");
+    fprintf(stderr, "\t--search-slack <pct> ... or stop at one within pct%% of the request (default 10).\n");
+    fprintf(stderr, "\t--reset <how>      Start timing runs with mm_init (default), a heap snapshot,\n");
+    fprintf(stderr, "\t                   or a snapshot with the heap prefaulted and flushed (clean).\n");
+    fprintf(stderr, "\t--timeline <file>  Write free space by size class over time as CSV.\n");
+    fprintf(stderr, "\t--interval <n>     Ops between timeline samples (default 100).\n");
 }
@@ -10,6 +10,9 @@
 #include <sys/mman.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/file.h>
 
 #include "memlib.h"
 #include "config.h"
@@ -18,20 +21,120 @@
 static char *mem_start_brk;  /* points to first byte of heap */
 static char *mem_brk;        /* points to last byte of heap */
 static char *mem_max_addr;   /* largest legal heap address */ 
+static char *mem_high_brk;   /* highest brk since mem_init */
+static char *snap_buf;       /* copy of the heap at mem_snapshot... */
+static size_t snap_size;     /* ... which held this many bytes */
+
+/*
+ * A heap file (mem_init_file) starts with this header; the heap itself
+ * starts one page in. The header keeps the brk, so that the next
+ * process to map the file gets the heap back as it was left.
+ */
+#define MEM_FILE_MAGIC 0x6d656d66  /* "memf" */
+
+typedef struct {
+    unsigned magic;
+    size_t max_heap;         /* MAX_HEAP of the program that made it */
+    size_t brk;              /* heap size */
+} mem_file_t;
+
+static mem_file_t *mem_file; /* the header, if the heap is a file */
+static int mem_fd = -1;      /* and the file */
 
 /* 
  * mem_init - initialize the memory system model
  */
 void mem_init(void)
 {
+#ifdef MEMLIB_MMAP
+    /* 
+     * When memlib backs the LD_PRELOAD shim, malloc is ourselves, so
+     * reserve the model VM directly from the kernel. MAP_NORESERVE
+     * keeps the reservation cheap; only touched pages count toward RSS.
+     */
+    mem_start_brk = mmap(NULL, MAX_HEAP, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mem_start_brk == MAP_FAILED) {
+	fprintf(stderr, "mem_init_vm: mmap error\n");
+	exit(1);
+    }
+#else
     /* allocate the storage we will use to model the available VM */
     if ((mem_start_brk = (char *)malloc(MAX_HEAP)) == NULL) {
 	fprintf(stderr, "mem_init_vm: malloc error\n");
 	exit(1);
     }
+#endif
 
     mem_max_addr = mem_start_brk + MAX_HEAP;  /* max legal heap address */
     mem_brk = mem_start_brk;                  /* heap is empty initially */
+    mem_high_brk = mem_start_brk;
+}
+
+/*
+ * mem_init_file - initialize the memory system model with the file at
+ *    path as the heap, creating it if need be. Returns 1 if the file
+ *    already held a heap, which is then mapped exactly as it was left,
+ *    0 if the heap is new and empty, or -1 on error (with errno set).
+ *    The file stays locked until mem_deinit, so a second process fails
+ *    with EBUSY. Call it instead of mem_init.
+ */
+int mem_init_file(char *path)
+{
+    size_t page = mem_pagesize();
+    struct stat st;
+    char *map;
+    int fd, old;
+
+    if ((fd = open(path, O_RDWR | O_CREAT, 0600)) < 0)
+	return -1;
+    if (flock(fd, LOCK_EX | LOCK_NB) < 0) {
+	if (errno == EWOULDBLOCK)
+	    errno = EBUSY;
+	close(fd);
+	return -1;
+    }
+    if (fstat(fd, &st) < 0 ||
+	(st.st_size == 0 && ftruncate(fd, page + MAX_HEAP) < 0) ||
+	(map = mmap(NULL, page + MAX_HEAP, PROT_READ | PROT_WRITE,
+		    MAP_SHARED, fd, 0)) == MAP_FAILED) {
+	close(fd);
+	return -1;
+    }
+
+    /* Never take over a file that is not one of our heaps, or all of one */
+    mem_file = (mem_file_t *)map;
+    old = (st.st_size != 0);
+    if (old && (st.st_size < page + MAX_HEAP ||
+		mem_file->magic != MEM_FILE_MAGIC ||
+		mem_file->max_heap != MAX_HEAP)) {
+	munmap(map, page + MAX_HEAP);
+	close(fd);
+	mem_file = NULL;
+	errno = EINVAL;
+	return -1;
+    }
+    if (!old) {
+	mem_file->max_heap = MAX_HEAP;
+	mem_file->brk = 0;
+	mem_file->magic = MEM_FILE_MAGIC;
+    }
+
+    mem_fd = fd;
+    mem_start_brk = map + page;
+    mem_max_addr = mem_start_brk + MAX_HEAP;
+    mem_brk = mem_start_brk + mem_file->brk;
+    mem_high_brk = mem_brk;
+    return old;
+}
+
+/*
+ * mem_sync - write the heap file back to disk
+ */
+void mem_sync(void)
+{
+    if (mem_file)
+	msync(mem_file, mem_pagesize() + (mem_brk - mem_start_brk), MS_SYNC);
 }
 
 /* 
@@ -39,7 +142,22 @@ void mem_init(void)
  */
 void mem_deinit(void)
 {
-    free(mem_start_brk);
+    if (mem_file) {
+	munmap(mem_file, mem_pagesize() + MAX_HEAP);
+	flock(mem_fd, LOCK_UN);
+	close(mem_fd);
+	mem_file = NULL;
+	mem_fd = -1;
+    }
+    else {
+#ifdef MEMLIB_MMAP
+	munmap(mem_start_brk, MAX_HEAP);
+#else
+	free(mem_start_brk);
+#endif
+    }
+    free(snap_buf);
+    snap_buf = NULL;
 }
 
 /*
@@ -48,6 +166,8 @@ void mem_deinit(void)
 void mem_reset_brk()
 {
     mem_brk = mem_start_brk;
+    if (mem_file)
+	mem_file->brk = 0;
 }
 
 /* 
@@ -65,9 +185,68 @@ void *mem_sbrk(int incr)
 	return (void *)-1;
     }
     mem_brk += incr;
+    if (mem_brk > mem_high_brk)
+	mem_high_brk = mem_brk;
+    if (mem_file)
+	mem_file->brk = mem_brk - mem_start_brk;
     return (void *)old_brk;
 }
 
+/*
+ * mem_snapshot - save the heap as it is now, for mem_restore
+ */
+void mem_snapshot(void)
+{
+    snap_size = mem_brk - mem_start_brk;
+    if ((snap_buf = realloc(snap_buf, snap_size + 1)) == NULL) {
+	fprintf(stderr, "mem_snapshot: realloc error\n");
+	exit(1);
+    }
+    memcpy(snap_buf, mem_start_brk, snap_size);
+}
+
+/*
+ * mem_restore - put the heap back as it was at the last mem_snapshot.
+ *    Only the snapshot's bytes are copied; the rest of the old heap is
+ *    simply beyond the brk again.
+ */
+void mem_restore(void)
+{
+    memcpy(mem_start_brk, snap_buf, snap_size);
+    mem_brk = mem_start_brk + snap_size;
+    if (mem_file)
+	mem_file->brk = snap_size;
+}
+
+/*
+ * mem_prefault - write to every page the heap has ever used, so that
+ *    none of them faults in a later run
+ */
+void mem_prefault(void)
+{
+    size_t size = mem_high_brk - mem_start_brk;
+    size_t pagesize = mem_pagesize();
+    size_t i;
+
+    for (i = 0; i < size; i += pagesize)
+	((volatile char *)mem_start_brk)[i] = mem_start_brk[i];
+}
+
+/*
+ * mem_flush - evict every line the heap has ever used from the caches,
+ *    so that each run finds the heap in the same (uncached) state
+ */
+void mem_flush(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+    char *p;
+
+    for (p = mem_start_brk; p < mem_high_brk; p += 64)
+	__builtin_ia32_clflush(p);
+    __builtin_ia32_mfence();
+#endif
+}
+
 /*
  * mem_heap_lo - return address of the first heap byte
  */
@@ -1,9 +1,15 @@
 #include <unistd.h>
 
 void mem_init(void);               
+int mem_init_file(char *path);
+void mem_sync(void);
 void mem_deinit(void);
 void *mem_sbrk(int incr);
 void mem_reset_brk(void); 
+void mem_snapshot(void);
+void mem_restore(void);
+void mem_prefault(void);
+void mem_flush(void);
 void *mem_heap_lo(void);
 void *mem_heap_hi(void);
 size_t mem_heapsize(void);
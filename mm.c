@@ -6,9 +6,16 @@
 #include <assert.h>
 #include <unistd.h>
 #include <string.h>
+#include <errno.h>
+#include <pthread.h>
 
 #include "memlib.h"
 #include "mm.h"
+#include "config.h"
+
+#if MM_PACKED_LISTS && (defined(__AVX2__) || defined(__SSE2__))
+#include <immintrin.h>
+#endif
 /*********************************************************
  * NOTE TO STUDENTS: Before you do anything else, please
  * provide your team information in the following struct.
@@ -46,16 +53,36 @@ team_t team = {
 #define GET_SIZE(p)   (GET(p) & ~(DSIZE - 1))
 #define GET_ALLOC(p)  (GET(p) & 0x1)
 
+/*
+ * Upward reallocs of allocated block bp so far (saturating at 3), kept
+ * in bits 1-2 of its footer, which block sizes never use. The header
+ * stays plain: mmshim.c tags memalign'ed payloads with bit 1 of the
+ * word in front of them.
+ */
+#define GET_GROWS(bp)  ((GET(FTRP(bp)) >> 1) & 0x3)
+#define PACK_GROWS(size, grows)  (PACK(size, 1) | ((grows) << 1))
+
 /* Address of free block's predecessor and successor entries */
 #define PRED_PTR(ptr) ((char *)(ptr))
 #define SUCC_PTR(ptr) ((char *)(ptr) + WSIZE)
 
+/*
+ * List links are stored as offsets from the start of the heap, 0 for
+ * none, so that a heap file mapped at another address is still intact
+ */
+#define LINK(ptr)    ((ptr) == NULL ? 0 : (unsigned int)((char *)(ptr) - heap_lo))
+#define UNLINK(off)  ((off) == 0 ? NULL : heap_lo + (off))
+
 /* Address of free block's predecessor and successor on the segregated list */
-#define PRED(ptr) (*(char **)(ptr))
-#define SUCC(ptr) (*(char **)(SUCC_PTR(ptr)))
+#define PRED(ptr) UNLINK(*(unsigned int *)(ptr))
+#define SUCC(ptr) UNLINK(*(unsigned int *)(SUCC_PTR(ptr)))
 
 /* Store predecessor or successor pointer for free blocks */
-#define STORE(p, ptr) (*(unsigned int *)(p) = (unsigned int)(ptr))
+#define STORE(p, ptr) (*(unsigned int *)(p) = LINK(ptr))
+
+/* First block of segregated list i, and setting it */
+#define HEAD(i)          PRED(seg_listp + (i))
+#define SET_HEAD(i, ptr) STORE(seg_listp + (i), ptr)
 
 /* Given block ptr bp, compute address of its header and footer */
 #define HDRP(bp)  ((void *)(bp) - WSIZE)
@@ -73,11 +100,89 @@ team_t team = {
 #define SET_NEXT_FREE(bp, qp) (GET_NEXT_FREE(bp) = qp)
 #define SET_PREV_FREE(bp, qp) (GET_PREV_FREE(bp) = qp)
 
+/* Start loading the word at p into the cache (MM_PREFETCH) */
+#if MM_PREFETCH
+#define PREFETCH(p) __builtin_prefetch(p)
+#else
+#define PREFETCH(p) ((void)0)
+#endif
+
+/* Whether this build prefetches, for the driver to report */
+const int mm_prefetch = MM_PREFETCH;
+
 /* Address of next and previous blocks */
 #define NEXT(ptr) ((char *)(ptr) + GET_SIZE((char *)(ptr) - WSIZE))
 #define PREV(ptr) ((char *)(ptr) - GET_SIZE((char *)(ptr) - DSIZE))
 
-#define LISTS     20      /* Number of segregated lists */
+#define LISTS     MM_LISTS /* Number of segregated lists */
+#define SPLIT_LARGE 100     /* MM_SPLIT_SIZE: blocks this big go at the back */
+#define GROW_MOVES  2       /* Upward moves before a block moves to the top */
+
+/*
+ * Packed lists (MM_PACKED_LISTS): pack_size[i][k] and pack_off[i][k]
+ * are the size and heap offset of the k-th block of list i. A list
+ * that outgrows PACK_MAX blocks "spills": it is searched by following
+ * its links again until it shrinks to PACK_LOW blocks, when it is
+ * packed again. The gap keeps a list that hovers around PACK_MAX from
+ * being packed over and over.
+ */
+#define PACK_MAX  1024
+#define PACK_LOW  (PACK_MAX / 2)
+
+/*
+ * BiBoP ("big bag of pages"): requests up to BIBOP_MAX bytes come from
+ * RUN_SIZE runs, each holding objects of a single size class and
+ * aligned to RUN_SIZE relative to the start of the heap. The run
+ * descriptor of any address is runs[RUN_INDEX(p)], so objects need no
+ * header: freeing one is a table lookup and a push onto its run's
+ * free list. A run is an ordinary allocated block to the rest of mm.c.
+ */
+#define RUN_BITS    16
+#define RUN_SIZE    (1 << RUN_BITS)
+#define RUN_INDEX(p) ((size_t)((char *)(p) - heap_lo) >> RUN_BITS)
+#define BIBOP_MAX   MM_BIBOP_MAX /* Largest request served from a run */
+#define NCLASSES    24    /* Number of run size classes */
+#define EMPTY_KEPT  2     /* Empty runs kept for reuse, the rest are freed */
+
+/* Regions bump through chunks of at least REGION_CHUNK bytes */
+#define REGION_CHUNK (1 << 14)
+
+/* A chunk starts with the link to the region's previous chunk */
+typedef struct chunk {
+  struct chunk *next;
+  char pad[DSIZE - sizeof(struct chunk *)]; /* objects start aligned */
+} chunk_t;
+
+struct mm_region {
+  char *cur;               /* next free byte in the newest chunk */
+  char *end;               /* end of the newest chunk */
+  chunk_t *chunks;         /* newest chunk first, oldest (kept by reset) last */
+};
+
+/* Pools carve slots out of chunks of at least POOL_CHUNK bytes */
+#define POOL_CHUNK (1 << 14)
+
+struct mm_pool {
+  size_t slot;             /* object size rounded up to the alignment */
+  size_t align;
+  char *free;              /* freed slots, linked through their first word */
+  char *cur;               /* never used slots in the newest chunk... */
+  char *end;               /* ... end here */
+  chunk_t *chunks;         /* every chunk, newest first */
+  unsigned id;             /* never reused, unlike the pool's address */
+  unsigned parent;         /* for a per-thread pool, the id of the pool
+			      it stands for, else 0 */
+  struct mm_pool *local_next; /* the thread's next per-thread pool */
+};
+
+typedef struct run {
+  int cls;                 /* size class + 1, or 0 if not an active run */
+  int nfree;               /* free objects, including the untouched tail */
+  char *free;              /* freed objects, linked through their first word */
+  char *tail;              /* objects from here on have never been used */
+  struct run *prev;        /* runs of the class that have free objects */
+  struct run *next;
+} run_t;
 
 /* Global declarations */
 static char *heap_listp = 0; 
@@ -86,14 +191,99 @@ static char *free_listp = 0;
 //void *free_lists[LISTS]; /* Array of pointers to segregated free lists */
 int *seg_listp;
 char *prologue_block;    /* Pointer to prologue block */
+static int fit_policy = MM_FIT_SIZE; /* Order of the free lists */
+static int search_policy = MM_SEARCH_FIRST; /* Which fitting block to take */
+static int search_budget = 8;  /* Good fit: fitting blocks to look at... */
+static int search_slack = 10;  /* ... unless one is within this percent */
+static char *rover[LISTS];     /* Next fit: where each list's search stopped */
+static int split_policy = MM_SPLIT_FRONT; /* Which end of a split block to use */
+
+/* BiBoP state */
+static int bibop = 0;                    /* Serve small requests from runs? */
+static char *heap_lo;                    /* Start of the heap */
+static run_t runs[MAX_HEAP >> RUN_BITS]; /* Descriptor of each RUN_SIZE page */
+static run_t *partial[NCLASSES];         /* Runs with free objects, by class */
+static run_t *empty_runs;                /* Empty runs kept for reuse */
+static int nempty;
+static __thread mm_pool_t *local_pools; /* This thread's per-thread pools */
+static unsigned pool_ids;                /* Ids given out to pools so far */
+
+/*
+ * Per-thread pools are used from several threads, so the pool functions
+ * take pool_lock around everything they do in the heap (and around
+ * pool_ids). The rest of mm.c is still single threaded.
+ */
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned char size_class[BIBOP_MAX / 16 + 1]; /* Class of (size+15)/16 */
+static const int class_size[NCLASSES] = {
+  16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256,
+  320, 384, 448, 512, 640, 768, 896, 1024, 1280, 1536, 1792, 2048
+};
+
+/*
+ * A persistent heap (mm_attach) starts with this header, ahead of the
+ * segregated list heads. The epoch goes up by one on every attach and
+ * every detach, so it is odd while a process has the heap; a heap
+ * found with an odd epoch was never detached and may be inconsistent.
+ */
+#define HEAP_MAGIC   0x6d6d6870  /* "mmhp" */
+#define HEAP_VERSION (LISTS << 8 | WSIZE << 4 | 1)
+
+typedef struct {
+  unsigned magic;
+  unsigned version;        /* HEAP_VERSION of the mm.c that made it */
+  unsigned fit;            /* its fit policy, which orders the lists */
+  unsigned epoch;
+  unsigned root;           /* offset of the root object, or 0 */
+  unsigned pad;            /* keeps the blocks after it aligned */
+} heap_hdr_t;
+
+static heap_hdr_t *heap_hdr;  /* The header, if the heap is persistent */
+
+#if MM_PACKED_LISTS
+/* Packed copies of the segregated lists */
+static unsigned pack_size[LISTS][PACK_MAX];
+static unsigned pack_off[LISTS][PACK_MAX];
+static int pack_n[LISTS];
+static char pack_spilled[LISTS];
+static int pack_len[LISTS];    /* Blocks in a spilled list */
+#endif
 
 /* Function prototypes for internal helper routines */
 static void *coalesce(void *bp);
 static void *extend_heap(size_t words);
-static void *find_fit(size_t asize);
-static void place(void *bp, size_t asize);
+static void *malloc_block(size_t asize, int listNum);
+static void *find_fit(size_t asize, int listNum);
+static void *search_list(int listNum, size_t asize);
+static void *place(void *bp, size_t asize);
+static void *top_block(size_t asize);
+static int top_taken(void);
+static int resize_block(void *bp, size_t asize);
+static int split_back(void *bp, size_t asize);
 static void insert_node(void *bp, size_t size);
 static void delete_node(void *bp);
+static size_t adjust_size(size_t size);
+static int list_index(size_t size);
+
+/* Packed list functions */
+#if MM_PACKED_LISTS
+static int pack_first(const unsigned *a, int n, unsigned key);
+static void *pack_fit(int listNum, size_t asize);
+static int pack_insert(int listNum, void *bp, size_t size, void **sptr, void **iptr);
+static void pack_delete(int listNum, void *bp);
+static void pack_list(int listNum);
+static void pack_rebuild(void);
+#endif
+
+/* BiBoP functions */
+static void bibop_init(void);
+static void *bibop_malloc(int cls);
+static void bibop_free(run_t *r, void *bp);
+static run_t *new_run(int cls);
+static char *alloc_run(void);
+static char *carve_run(void);
+static void link_run(run_t *r);
+static void unlink_run(run_t *r);
 
 /* Free List Functions*/
 static void addToFree(void *bp); 
@@ -110,93 +300,266 @@ static void printblock(void *bp);
 int mm_init(void) {
   
   int listNum;
-  int *seg = heap_listp + 4*WSIZE;
-  
-  for (listNum = 0; listNum < LISTS; listNum++)
-  {
-	*(seg + listNum) = NULL;
-  }
   
-  /* Create the initial empty heap. */
-  if ((heap_listp = mem_sbrk(24*WSIZE)) == NULL){
+  /* 
+   * Create the initial empty heap. The segregated list heads live at
+   * the very start of the heap, so nothing is touched before mem_sbrk
+   * hands us the memory (the first call has no heap to write into).
+   * A persistent heap has its header in front of them.
+   */
+  if (heap_hdr && mem_sbrk(sizeof(heap_hdr_t)) == (void *)-1)
+    return -1;
+  if ((seg_listp = mem_sbrk(24*WSIZE)) == (void *)-1){
 //     printf("ERROR");
     return -1;
   }
 
+  heap_lo = mem_heap_lo();
+  for (listNum = 0; listNum < LISTS; listNum++)
+  {
+	SET_HEAD(listNum, NULL);
+  }
+  heap_listp = (char *)(seg_listp + LISTS);
+  memset(rover, 0, sizeof(rover));
+#if MM_PACKED_LISTS
+  memset(pack_n, 0, sizeof(pack_n));
+  memset(pack_spilled, 0, sizeof(pack_spilled));
+  memset(pack_len, 0, sizeof(pack_len));
+#endif
+
   PUT(heap_listp, 0);                            /* Alignment padding */
   PUT(heap_listp + (1 * WSIZE), PACK(DSIZE, 1)); /* Prologue header */ 
   PUT(heap_listp + (2 * WSIZE), PACK(DSIZE, 1)); /* Prologue footer */ 
   PUT(heap_listp + (3 * WSIZE), PACK(0, 1));     /* Epilogue header */
   free_listp = heap_listp + 2*WSIZE; 
-  seg_listp = heap_listp + 4*WSIZE;
 
   /* Extend the empty heap with a free block of minimum possible block size */
   if (extend_heap(CHUNKSIZE/WSIZE) == NULL){ 
     return -1;
   }
+
+  if (bibop)
+    bibop_init();
+  if (heap_hdr)
+  {
+    heap_hdr->version = HEAP_VERSION;
+    heap_hdr->fit = fit_policy;
+    heap_hdr->epoch |= 1;
+    heap_hdr->root = 0;
+    heap_hdr->magic = HEAP_MAGIC;
+  }
+  return 0;
+}
+
+/*
+ * The allocator's state outside the heap as mm_snapshot found it. The
+ * heap itself, list heads included, is saved by memlib.
+ */
+static struct {
+  int *seg_listp;
+  char *heap_listp;
+  char *free_listp;
+  char *rover[LISTS];
+#if MM_PACKED_LISTS
+  int pack_n[LISTS];
+  char pack_spilled[LISTS];
+  int pack_len[LISTS];
+  unsigned pack_size[LISTS][PACK_MAX];
+  unsigned pack_off[LISTS][PACK_MAX];
+#endif
+} snap;
+
+/*
+ * mm_snapshot - Save the heap and the allocator as they are now, which
+ *     is normally just after mm_init, for mm_restore
+ */
+void mm_snapshot(void){
+
+#if MM_PACKED_LISTS
+  int i;
+#endif
+
+  mem_snapshot();
+  snap.seg_listp = seg_listp;
+  snap.heap_listp = heap_listp;
+  snap.free_listp = free_listp;
+  memcpy(snap.rover, rover, sizeof(rover));
+#if MM_PACKED_LISTS
+  memcpy(snap.pack_n, pack_n, sizeof(pack_n));
+  memcpy(snap.pack_spilled, pack_spilled, sizeof(pack_spilled));
+  memcpy(snap.pack_len, pack_len, sizeof(pack_len));
+  for (i = 0; i < LISTS; i++)
+  {
+	memcpy(snap.pack_size[i], pack_size[i], pack_n[i] * sizeof(unsigned));
+	memcpy(snap.pack_off[i], pack_off[i], pack_n[i] * sizeof(unsigned));
+  }
+#endif
+}
+
+/*
+ * mm_restore - Go back to the last mm_snapshot. This does what
+ *     mem_reset_brk and mm_init would, but by copying the few bytes
+ *     they write instead of building the heap again. Only the packed
+ *     list entries in use at the snapshot are copied back.
+ */
+int mm_restore(void){
+
+#if MM_PACKED_LISTS
+  int i;
+#endif
+
+  mem_restore();
+  seg_listp = snap.seg_listp;
+  heap_listp = snap.heap_listp;
+  free_listp = snap.free_listp;
+  memcpy(rover, snap.rover, sizeof(rover));
+#if MM_PACKED_LISTS
+  memcpy(pack_n, snap.pack_n, sizeof(pack_n));
+  memcpy(pack_spilled, snap.pack_spilled, sizeof(pack_spilled));
+  memcpy(pack_len, snap.pack_len, sizeof(pack_len));
+  for (i = 0; i < LISTS; i++)
+  {
+	memcpy(pack_size[i], snap.pack_size[i], pack_n[i] * sizeof(unsigned));
+	memcpy(pack_off[i], snap.pack_off[i], pack_n[i] * sizeof(unsigned));
+  }
+#endif
+
+  if (bibop)
+    bibop_init();
   return 0;
 }
 
+/*
+ * mm_attach - Use the file at path as the heap, in place of mem_init
+ *     and mm_init. A new file gets an empty heap. A file that holds a
+ *     heap that was detached cleanly gets it back, with every block
+ *     still allocated, without rebuilding anything: the list links
+ *     are offsets, so it does not matter where the file is mapped.
+ *     Returns -1 with errno set if the file cannot be mapped, holds a
+ *     heap made by a different mm.c (EINVAL), or holds one that another
+ *     process has attached or that was never detached (EBUSY).
+ */
+int mm_attach(char *path){
+
+  int old, err = ENOMEM;
+
+  if ((old = mem_init_file(path)) < 0)
+    return -1;
+  heap_lo = mem_heap_lo();
+  heap_hdr = (heap_hdr_t *)heap_lo;
+  bibop = 0;  /* the runs' state is not in the heap */
+
+  if (!old || mem_heapsize() == 0)
+  {
+    if (mm_init() == 0)
+      return 0;
+  }
+  else if (heap_hdr->magic != HEAP_MAGIC || heap_hdr->version != HEAP_VERSION)
+    err = EINVAL;
+  else if (heap_hdr->epoch & 1)
+    err = EBUSY;
+  else
+  {
+    seg_listp = (int *)(heap_lo + sizeof(heap_hdr_t));
+    heap_listp = (char *)(seg_listp + LISTS);
+    free_listp = heap_listp + 2*WSIZE;
+    fit_policy = heap_hdr->fit;
+    memset(rover, 0, sizeof(rover));
+#if MM_PACKED_LISTS
+    pack_rebuild();
+#endif
+    heap_hdr->epoch++;
+    return 0;
+  }
+
+  heap_hdr = NULL;
+  mem_deinit();
+  errno = err;
+  return -1;
+}
+
+/*
+ * mm_detach - Write a persistent heap back to its file and unmap it.
+ *     The epoch only says the heap is whole once everything else is
+ *     on disk.
+ */
+void mm_detach(void){
+
+  if (heap_hdr == NULL)
+    return;
+  mem_sync();
+  heap_hdr->epoch = (heap_hdr->epoch + 1) & ~1;
+  mem_sync();
+  heap_hdr = NULL;
+  mem_deinit();
+}
+
+/*
+ * mm_set_root, mm_root - The object a program finds its data from when
+ *     it attaches a persistent heap again
+ */
+void mm_set_root(void *ptr){
+
+  if (heap_hdr)
+    heap_hdr->root = LINK(ptr);
+}
+
+void *mm_root(void){
+
+  return heap_hdr ? UNLINK(heap_hdr->root) : NULL;
+}
+
 /* 
  * mm_malloc - Allocate a block with at least size bytes of payload 
  */
 void *mm_malloc(size_t size) 
 {
   size_t asize;      /* Adjusted block size */
-  size_t extendsize; /* Amount to extend heap if no fit */
-  char *bp;
-  int listNum = 0;
 
   /* Ignore spurious requests. */
   if (size == 0)
     return (NULL);
 
-  /* Adjust block size to include overhead and alignment reqs. */
-  if (size <= DSIZE)
-    asize = 2 * DSIZE;
-  else
-    asize = DSIZE * ((size + (DSIZE) + (DSIZE - 1)) / DSIZE);
+  if (bibop && size <= BIBOP_MAX)
+    return bibop_malloc(size_class[(size + 15) >> 4]);
 
-  while (listNum < LISTS)
-  {
-	if ((listNum == LISTS - 1) || (asize <= 1) && (*(seg_listp + listNum) != NULL))
-	{
-	  bp = *(seg_listp + listNum);
-	  while ((bp != NULL) && (asize > GET_SIZE(HDRP(bp))))
-	  {
-		bp = PRED(bp);
-	  }
-	  if (bp != NULL)
-		break;
-	}
-	size >>= 1;
-	listNum++;
-  }
-  
-  if (bp == NULL)
+  asize = adjust_size(size);
+  return malloc_block(asize, list_index(asize));
+} 
+
+/*
+ * mm_malloc_fixed - mm_malloc for a constant size, whose block size
+ *     asize, list listNum and run class cls MM_MALLOC has worked out
+ *     at compile time
+ */
+void *mm_malloc_fixed(size_t size, size_t asize, int listNum, int cls)
+{
+  if (bibop && size <= BIBOP_MAX)
+    return bibop_malloc(cls);
+  return malloc_block(asize, listNum);
+}
+
+/*
+ * malloc_block - Allocate a block of asize bytes, searching the lists
+ *     from listNum, the list of asize, up
+ */
+static void *malloc_block(size_t asize, int listNum)
+{
+  size_t extendsize; /* Amount to extend heap if no fit */
+  char *bp = NULL;
+
+  /* Search the free lists for a fit. */
+  if ((bp = find_fit(asize, listNum)) == NULL)
   {
+	/* No fit found.  Get more memory and place the block. */
 	extendsize = MAX(asize, CHUNKSIZE);
-	if ((bp = extend_heap(extendsize)) == NULL)
+	if ((bp = extend_heap(extendsize / WSIZE)) == NULL)
 	{
 	  return NULL;
 	}
   }
   
-  place(bp, asize);
-	
-  return bp;
-  /* Search the free list for a fit. */
-  //if ((bp = find_fit(asize)) != NULL) {
-  //  place(bp, asize);
-  //  return (bp);
-  //}
-
-  /* No fit found.  Get more memory and place the block. */
-  //extendsize = MAX(asize, CHUNKSIZE);
-  //if ((bp = extend_heap(extendsize / WSIZE)) == NULL)  
-  //  return (NULL);
-  //place(bp, asize);
-  //return bp;
+  return place(bp, asize);
 } 
 
 /* 
@@ -204,12 +567,23 @@ void *mm_malloc(size_t size)
  */
 void mm_free(void *bp){
 
+  run_t *r;
+
   /* Ignore incorrect requests. */
   if (bp == NULL)
     return;
 
+  if (bibop && (r = &runs[RUN_INDEX(bp)])->cls) {
+    bibop_free(r, bp);
+    return;
+  }
+
   size_t size = GET_SIZE(HDRP(bp));
   
+  /* coalesce will need both neighbours' headers */
+  PREFETCH(HDRP(NEXT_BLK(bp)));
+  PREFETCH(HDRP(PREV_BLK(bp)));
+  
   PUT(HDRP(bp), PACK(size, 0));
   PUT(FTRP(bp), PACK(size, 0));
   
@@ -221,11 +595,28 @@ void mm_free(void *bp){
 }
 
 /*
- * mm_realloc - Naive implementation of realloc
+ * mm_free_sized - Free block bp, which was allocated with size bytes.
+ *     Knowing the size saves looking up whether bp lies in a run.
+ */
+void mm_free_sized(void *bp, size_t size){
+
+  if (bibop && (bp != NULL) && (size <= BIBOP_MAX)) {
+    bibop_free(&runs[RUN_INDEX(bp)], bp);
+    return;
+  }
+  mm_free(bp);
+}
+
+/*
+ * mm_realloc - Resize block ptr, in place if it can be. A block that
+ *     cannot grow in place moves; one that keeps growing is moved to
+ *     the top of the heap, so that from then on it grows with the heap
+ *     instead of being copied.
  */ 
 void *mm_realloc(void *ptr, size_t size){
   
     size_t oldsize;
+    int grows = 0;
     void *newptr;
 
     /* If size == 0 then this is just free, and we return NULL. */
@@ -239,15 +630,28 @@ void *mm_realloc(void *ptr, size_t size){
         return mm_malloc(size);
     }
 
-    newptr = mm_malloc(size);
+    /* Run objects, and blocks that would become one, simply move */
+    if (!(bibop && (runs[RUN_INDEX(ptr)].cls || size <= BIBOP_MAX))) {
+	if (resize_block(ptr, adjust_size(size)))
+	    return ptr;
+	grows = MIN(GET_GROWS(ptr) + 1, 3);
+    }
+
+    /* The top is for one growing block at a time */
+    if (grows >= GROW_MOVES && !top_taken())
+	newptr = top_block(adjust_size(size));
+    else
+	newptr = mm_malloc(size);
 
     /* If realloc() fails the original block is left untouched  */
     if(!newptr) {
         return 0;
     }
+    if (grows > 0)
+	PUT(FTRP(newptr), PACK_GROWS(GET_SIZE(HDRP(newptr)), grows));
 
     /* Copy the old data. */
-    oldsize = GET_SIZE(HDRP(ptr));
+    oldsize = mm_usable_size(ptr);
     if(size < oldsize) oldsize = size;
     memcpy(newptr, ptr, oldsize);
 
@@ -255,7 +659,107 @@ void *mm_realloc(void *ptr, size_t size){
     mm_free(ptr);
 
     return newptr;
-} 
+}
+
+/*
+ * mm_set_fit - Select the fit policy (MM_FIT_xxx) for the next mm_init
+ */
+void mm_set_fit(int policy){
+
+  fit_policy = policy;
+}
+
+/*
+ * mm_set_split - Select the split policy (MM_SPLIT_xxx)
+ */
+void mm_set_split(int policy){
+
+  split_policy = policy;
+}
+
+/*
+ * mm_set_search - Select the search policy (MM_SEARCH_xxx) and, for
+ *     good fit, its budget and slack
+ */
+void mm_set_search(int policy, int budget, int slack){
+
+  search_policy = policy;
+  search_budget = MAX(budget, 1);
+  search_slack = MAX(slack, 0);
+}
+
+/*
+ * mm_usable_size - Return the number of payload bytes in block ptr
+ */
+size_t mm_usable_size(void *ptr){
+
+  if (ptr == NULL)
+    return 0;
+
+  if (bibop && runs[RUN_INDEX(ptr)].cls)
+    return class_size[runs[RUN_INDEX(ptr)].cls - 1];
+  return GET_SIZE(HDRP(ptr)) - DSIZE;
+}
+
+/*
+ * mm_heapstats - Walk the heap and total up its free blocks by class
+ */
+void mm_heapstats(heapstats_t *stats){
+
+  char *bp;
+  size_t size, s;
+  int listNum;
+  run_t *r;
+
+  memset(stats, 0, sizeof(heapstats_t));
+  stats->nclasses = LISTS;
+
+  /* The prologue block starts the walk, the epilogue (size 0) ends it */
+  for (bp = heap_listp + DSIZE; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLK(bp))
+  {
+	if (GET_ALLOC(HDRP(bp)))
+	  continue;
+	size = GET_SIZE(HDRP(bp));
+
+	/* Same class as insert_node would pick */
+	listNum = 0;
+	for (s = size; (listNum < LISTS - 1) && (s > 1); s >>= 1)
+	  listNum++;
+
+	stats->class_bytes[listNum] += size;
+	stats->free_bytes += size;
+	stats->free_blocks++;
+	stats->largest_free = MAX(stats->largest_free, size);
+  }
+
+  /* Free objects in runs, and empty runs, count as free but have no class */
+  if (bibop)
+  {
+	for (r = runs; r < runs + (mem_heapsize() >> RUN_BITS); r++)
+	  if (r->cls)
+		stats->free_bytes += r->nfree * class_size[r->cls - 1];
+	stats->free_bytes += nempty * RUN_SIZE;
+  }
+}
+
+/*
+ * mm_blockwaste - Add the bytes of allocated block ptr, which was
+ *     requested with size bytes, that are not payload to waste
+ */
+void mm_blockwaste(void *ptr, size_t size, blockwaste_t *waste){
+
+  size_t asize;
+
+  if (bibop && runs[RUN_INDEX(ptr)].cls) {
+    waste->align += mm_usable_size(ptr) - size;
+    return;
+  }
+
+  asize = adjust_size(size);
+  waste->overhead += DSIZE;
+  waste->align += asize - DSIZE - size;
+  waste->unsplit += GET_SIZE(HDRP(ptr)) - asize;
+}
 
 /* Loop through the heap anc check if all blocks are valid */
 // void checkheap(int verbose) 
@@ -300,14 +804,35 @@ static void *extend_heap(size_t words) {
   return coalesce(bp);
 }
 
-/* Puts block of size asize at loc bp */
-void place(void *bp, size_t asize){
+/*
+ * adjust_size - Block size for a request of size bytes: room for the
+ *     header and footer, rounded up to the alignment
+ */
+static size_t adjust_size(size_t size){
+
+  if (size <= DSIZE)
+    return 2 * DSIZE;
+  return DSIZE * ((size + (DSIZE) + (DSIZE - 1)) / DSIZE);
+}
+
+/*
+ * place - Puts block of size asize at loc bp, or at the back of it if
+ *     the split policy says so. Returns the allocated block.
+ */
+static void *place(void *bp, size_t asize){
   size_t csize = GET_SIZE(HDRP(bp));
   size_t leftover = csize - asize;
   
   delete_node(bp);
   
-  if ((leftover) >= 2 * DSIZE) {
+  if ((leftover >= 2 * DSIZE) && split_back(bp, asize)) {
+	PUT(HDRP(bp), PACK(leftover, 0));
+	PUT(FTRP(bp), PACK(leftover, 0));
+	insert_node(bp, leftover);
+	bp = NEXT_BLK(bp);
+	PUT(HDRP(bp), PACK(asize, 1));
+	PUT(FTRP(bp), PACK(asize, 1));
+  } else if ((leftover) >= 2 * DSIZE) {
     //make new block
     PUT(HDRP(bp), PACK(asize, 1));
     PUT(FTRP(bp), PACK(asize, 1));
@@ -318,61 +843,272 @@ void place(void *bp, size_t asize){
     //PUT(HDRP(bp), PACK(csize-asize, 0));
     //PUT(FTRP(bp), PACK(csize-asize, 0));
     //coalesce(bp);
+	PUT(HDRP(NEXT_BLK(bp)), PACK(leftover, 0));
+	PUT(FTRP(NEXT_BLK(bp)), PACK(leftover, 0));
 	insert_node(NEXT_BLK(bp), leftover);
   } else {
     PUT(HDRP(bp), PACK(csize, 1));
     PUT(FTRP(bp), PACK(csize, 1));
     //removeFromFree(bp);
   }
-  return;
+  return bp;
 }
 
+/*
+ * resize_block - Make allocated block bp asize bytes without moving it,
+ *     taking in the free block after it, and growing the heap if that
+ *     leaves bp on top. Returns 0 if bp has to move instead.
+ */
+static int resize_block(void *bp, size_t asize){
+
+  size_t bsize = GET_SIZE(HDRP(bp));
+  int grows = GET_GROWS(bp);
+  char *nextp = NEXT_BLK(bp);
+  int absorb = !GET_ALLOC(HDRP(nextp));
+  size_t room = bsize + (absorb ? GET_SIZE(HDRP(nextp)) : 0);
 
-/* find a free block of asize bytes */
+  if (asize < bsize)
+	grows = 0;  /* not a growing block after all */
 
-static void *find_fit(size_t asize){
-  void *bp;
+  if (room < asize)
+  {
+	/* Only the top block can grow past its neighbour */
+	if (GET_SIZE(HDRP((char *)bp + room)) != 0)
+	  return 0;
+	if (mem_sbrk(asize - room) == (void *)-1)
+	  return 0;
+	PUT(HDRP((char *)bp + asize), PACK(0, 1));  /* new epilogue header */
+	room = asize;
+  }
+  if (absorb)
+	delete_node(nextp);
 
-  for (bp = free_listp; GET_ALLOC(HDRP(bp)) == 0; bp = GET_NEXT_FREE(bp) ){
-    if (asize <= (size_t)GET_SIZE(HDRP(bp)) ) {
-      return bp;
-    }
-    
+  /* Give back what bp does not need */
+  if (room - asize >= 2 * DSIZE)
+  {
+	PUT(HDRP(bp), PACK(asize, 1));
+	PUT(FTRP(bp), PACK_GROWS(asize, grows));
+	nextp = NEXT_BLK(bp);
+	PUT(HDRP(nextp), PACK(room - asize, 0));
+	PUT(FTRP(nextp), PACK(room - asize, 0));
+	insert_node(nextp, room - asize);
+	coalesce(nextp);
   }
-  return NULL;
+  else
+  {
+	PUT(HDRP(bp), PACK(room, 1));
+	PUT(FTRP(bp), PACK_GROWS(room, grows));
+  }
+  return 1;
 }
 
 /*
- * coalesce - Boundary tag coalescing. Return ptr to coalesced block
+ * top_taken - Is the last block a growing block, which the top is
+ *     left to?
  */
-static void *coalesce(void *bp){
+static int top_taken(void){
 
-  size_t NEXT_ALLOC = GET_ALLOC(  HDRP(NEXT_BLK(bp))  );
-  size_t PREV_ALLOC = GET_ALLOC(  HDRP(PREV_BLK(bp))  );
-  //size_t PREV_ALLOC = GET_ALLOC(  FTRP(PREV_BLK(bp))  ) || PREV_BLK(bp) == bp;
-  size_t size = GET_SIZE(HDRP(bp));
-  
-  /*return if the previous and next blocks are both allocated */
-  if (PREV_ALLOC && NEXT_ALLOC)
+  char *bp = (char *)mem_heap_hi() + 1;  /* the block at the epilogue */
+
+  return GET_ALLOC(bp - DSIZE) && (GET_GROWS(PREV_BLK(bp)) >= GROW_MOVES);
+}
+
+/*
+ * top_block - Allocate a block of asize bytes that ends at the epilogue,
+ *     out of the back of the last block if that is free, and growing
+ *     the heap if need be
+ */
+static void *top_block(size_t asize){
+
+  char *bp = (char *)mem_heap_hi() + 1;  /* the block at the epilogue */
+  size_t lsize = 0;
+
+  if (!GET_ALLOC(bp - DSIZE))
   {
-	return bp;
+	/* The last block is free: take it out of its list */
+	bp = PREV_BLK(bp);
+	lsize = GET_SIZE(HDRP(bp));
+	delete_node(bp);
+	if (lsize >= asize + 2 * DSIZE)
+	{
+	  PUT(HDRP(bp), PACK(lsize - asize, 0));
+	  PUT(FTRP(bp), PACK(lsize - asize, 0));
+	  insert_node(bp, lsize - asize);
+	  bp = NEXT_BLK(bp);
+	  lsize = asize;
+	}
   }
-  
-  /*Remove old block from list*/
-  delete_node(bp);
-  
-  if (PREV_ALLOC && !NEXT_ALLOC)
+
+  if (lsize < asize)
   {
-	delete_node(NEXT_BLK(bp));
-	size += GET_SIZE(HDRP(NEXT_BLK(bp)));
-	PUT(HDRP(bp), PACK(size, 0));
-	PUT(FTRP(bp), PACK(size, 0));
+	if (mem_sbrk(asize - lsize) == (void *)-1)
+	{
+	  if (lsize > 0)
+		insert_node(bp, lsize);
+	  return NULL;
+	}
+	lsize = asize;
+	PUT(HDRP(bp + asize), PACK(0, 1));  /* new epilogue header */
   }
-  else if (!PREV_ALLOC && NEXT_ALLOC)
+
+  PUT(HDRP(bp), PACK(lsize, 1));
+  PUT(FTRP(bp), PACK(lsize, 1));
+  return bp;
+}
+
+/*
+ * split_back - Should asize bytes come from the back of free block bp?
+ */
+static int split_back(void *bp, size_t asize){
+
+  size_t prev, next;
+
+  switch (split_policy)
   {
-	delete_node(PREV_BLK(bp));
-	size += GET_SIZE(HDRP(PREV_BLK(bp)));
-	PUT(FTRP(bp), PACK(size, 0));
+  case MM_SPLIT_SIZE:
+	return asize >= SPLIT_LARGE;
+
+  case MM_SPLIT_NEIGHBOUR:
+	/* The prologue and epilogue count as blocks of size 8 and 0 */
+	prev = GET_SIZE((char *)bp - DSIZE);
+	next = GET_SIZE(HDRP(NEXT_BLK(bp)));
+	prev = (prev > asize) ? prev - asize : asize - prev;
+	next = (next > asize) ? next - asize : asize - next;
+	return next < prev;
+
+  default:
+	return 0;
+  }
+}
+
+
+/*
+ * list_index - Return the segregated list of blocks of size bytes
+ */
+static int list_index(size_t size){
+
+  int listNum = 0;
+
+  while ((listNum < LISTS - 1) && (size > 1))
+  {
+	size >>= 1;
+	listNum++;
+  }
+  return listNum;
+}
+
+/*
+ * find_fit - Find a free block of asize bytes: search the lists from
+ *     listNum, the list of asize, up, with the search policy in each
+ */
+static void *find_fit(size_t asize, int listNum){
+
+  void *bp;
+
+  for (; listNum < LISTS; listNum++)
+  {
+	if ((listNum == LISTS - 1) || (HEAD(listNum) != NULL))
+	{
+	  if ((bp = search_list(listNum, asize)) != NULL)
+		return bp;
+	}
+  }
+  return NULL;
+}
+
+/*
+ * search_list - Return the block of list listNum that the search
+ *     policy picks for asize bytes, or NULL if none fits
+ */
+static void *search_list(int listNum, size_t asize){
+
+  char *bp = HEAD(listNum);
+  char *best = NULL;
+  size_t size;
+  int seen = 0;
+
+  switch (search_policy)
+  {
+  case MM_SEARCH_NEXT:
+	/* From the rover to the end of the list, then from the head up to it */
+	for (bp = rover[listNum]; bp != NULL; bp = PRED(bp))
+	{
+	  PREFETCH(HDRP(PRED(bp)));
+	  if (asize <= GET_SIZE(HDRP(bp)))
+		return rover[listNum] = bp;
+	}
+	for (bp = HEAD(listNum); bp != rover[listNum]; bp = PRED(bp))
+	{
+	  PREFETCH(HDRP(PRED(bp)));
+	  if (asize <= GET_SIZE(HDRP(bp)))
+		return rover[listNum] = bp;
+	}
+	return NULL;
+
+  case MM_SEARCH_BEST:
+  case MM_SEARCH_GOOD:
+	for (; bp != NULL; bp = PRED(bp))
+	{
+	  PREFETCH(HDRP(PRED(bp)));
+	  size = GET_SIZE(HDRP(bp));
+	  if (asize > size)
+		continue;
+	  if ((best == NULL) || (size < GET_SIZE(HDRP(best))))
+		best = bp;
+	  if (fit_policy == MM_FIT_SIZE)
+		break;          /* a size ordered list has its best fit first */
+	  if ((search_policy == MM_SEARCH_GOOD) &&
+		  ((++seen >= search_budget) || ((size - asize) * 100 <= asize * search_slack)))
+		break;
+	}
+	return best;
+
+  default:
+#if MM_PACKED_LISTS
+	if (!pack_spilled[listNum])
+	  return pack_fit(listNum, asize);
+#endif
+	for (; bp != NULL; bp = PRED(bp))
+	{
+	  PREFETCH(HDRP(PRED(bp)));
+	  if (asize <= GET_SIZE(HDRP(bp)))
+		break;
+	}
+	return bp;
+  }
+}
+
+/*
+ * coalesce - Boundary tag coalescing. Return ptr to coalesced block
+ */
+static void *coalesce(void *bp){
+
+  size_t NEXT_ALLOC = GET_ALLOC(  HDRP(NEXT_BLK(bp))  );
+  size_t PREV_ALLOC = GET_ALLOC(  HDRP(PREV_BLK(bp))  );
+  //size_t PREV_ALLOC = GET_ALLOC(  FTRP(PREV_BLK(bp))  ) || PREV_BLK(bp) == bp;
+  size_t size = GET_SIZE(HDRP(bp));
+  
+  /*return if the previous and next blocks are both allocated */
+  if (PREV_ALLOC && NEXT_ALLOC)
+  {
+	return bp;
+  }
+  
+  /*Remove old block from list*/
+  delete_node(bp);
+  
+  if (PREV_ALLOC && !NEXT_ALLOC)
+  {
+	delete_node(NEXT_BLK(bp));
+	size += GET_SIZE(HDRP(NEXT_BLK(bp)));
+	PUT(HDRP(bp), PACK(size, 0));
+	PUT(FTRP(bp), PACK(size, 0));
+  }
+  else if (!PREV_ALLOC && NEXT_ALLOC)
+  {
+	delete_node(PREV_BLK(bp));
+	size += GET_SIZE(HDRP(PREV_BLK(bp)));
+	PUT(FTRP(bp), PACK(size, 0));
 	PUT(HDRP(PREV_BLK(bp)), PACK(size, 0));
 	bp = PREV(bp);
   }
@@ -406,25 +1142,50 @@ static void removeFromFree(void *bp){
   SET_PREV_FREE(GET_NEXT_FREE(bp), GET_PREV_FREE(bp));
 }
 
+/*
+ * insert_node - Insert free block bp into its segregated list. The list
+ *     runs from its head along the PRED links in increasing size, or
+ *     with MM_FIT_ADDRESS in increasing address, so that a first fit
+ *     search finds the smallest or the lowest fitting block.
+ */
 static void insert_node(void *bp, size_t size)
 {
   int listNum = 0;
+  size_t searchsize = size;
   void *sptr = bp;
   void *iptr = NULL;
   
   //select list
-  while ((listNum < LISTS - 1) && (size > 1))
+  while ((listNum < LISTS - 1) && (searchsize > 1))
   {
-	size >>= 1;
+	searchsize >>= 1;
 	listNum++;
   }
   
-  sptr = *(seg_listp + listNum);
+  sptr = HEAD(listNum);
   
-  while ((sptr != NULL) && (size > GET_SIZE(HDRP(sptr))))
+#if MM_PACKED_LISTS
+  if (!pack_insert(listNum, bp, size, &sptr, &iptr))
+#endif
   {
-	iptr = sptr;
-	sptr = PRED(sptr);
+	if (fit_policy == MM_FIT_ADDRESS)
+	{
+	  while ((sptr != NULL) && ((char *)sptr < (char *)bp))
+	  {
+		PREFETCH(HDRP(PRED(sptr)));
+		iptr = sptr;
+		sptr = PRED(sptr);
+	  }
+	}
+	else
+	{
+	  while ((sptr != NULL) && (size > GET_SIZE(HDRP(sptr))))
+	  {
+		PREFETCH(HDRP(PRED(sptr)));
+		iptr = sptr;
+		sptr = PRED(sptr);
+	  }
+	}
   }
   
   if (sptr != NULL)
@@ -441,6 +1202,8 @@ static void insert_node(void *bp, size_t size)
 	  STORE(PRED_PTR(bp), sptr);
 	  STORE(SUCC_PTR(sptr), bp);
 	  STORE(SUCC_PTR(bp), NULL);
+	  
+	  SET_HEAD(listNum, bp);
 	}
   }
   else
@@ -456,7 +1219,7 @@ static void insert_node(void *bp, size_t size)
 	  STORE(PRED_PTR(bp), NULL);
 	  STORE(SUCC_PTR(bp), NULL);
 	  
-	  *(seg_listp + listNum) = bp;
+	  SET_HEAD(listNum, bp);
 	  
 	}
   }
@@ -476,6 +1239,9 @@ static void delete_node(void *bp)
 	listNum++;
   }
   
+  if (rover[listNum] == bp)
+	rover[listNum] = PRED(bp);
+  
   if (PRED(bp) != NULL)
   {
 	if (SUCC(bp) != NULL)
@@ -486,7 +1252,7 @@ static void delete_node(void *bp)
 	else
 	{
 	  STORE(SUCC_PTR(PRED(bp)), NULL);
-	  *(seg_listp + listNum) = PRED(bp);
+	  SET_HEAD(listNum, PRED(bp));
 	}
   }
   else
@@ -497,14 +1263,594 @@ static void delete_node(void *bp)
 	}
 	else
 	{
-	  *(seg_listp + listNum) = NULL;
+	  SET_HEAD(listNum, NULL);
 	}
   }
   
+#if MM_PACKED_LISTS
+  pack_delete(listNum, bp);
+#endif
   return;
   
 }
 
+#if MM_PACKED_LISTS
+/*
+ * pack_first - Return the index of the first of the n words at a that
+ *     is at least key (1 <= key < 2^31), or n if there is none
+ */
+static int pack_first(const unsigned *a, int n, unsigned key){
+
+  int i = 0;
+#if defined(__AVX2__) || defined(__SSE2__)
+  int mask;
+#endif
+
+#if defined(__AVX2__)
+  __m256i k8 = _mm256_set1_epi32((int)key - 1);
+
+  for (; i + 8 <= n; i += 8)
+  {
+	mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(
+			 _mm256_loadu_si256((const __m256i *)(a + i)), k8)));
+	if (mask != 0)
+	  return i + __builtin_ctz(mask);
+  }
+#elif defined(__SSE2__)
+  __m128i k4 = _mm_set1_epi32((int)key - 1);
+
+  for (; i + 4 <= n; i += 4)
+  {
+	mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(
+			 _mm_loadu_si128((const __m128i *)(a + i)), k4)));
+	if (mask != 0)
+	  return i + __builtin_ctz(mask);
+  }
+#endif
+  for (; i < n; i++)
+	if (a[i] >= key)
+	  return i;
+  return n;
+}
+
+/*
+ * pack_fit - Return the first block of unspilled list listNum that can
+ *     hold asize bytes, or NULL
+ */
+static void *pack_fit(int listNum, size_t asize){
+
+  int k = pack_first(pack_size[listNum], pack_n[listNum], asize);
+
+  return (k < pack_n[listNum]) ? heap_lo + pack_off[listNum][k] : NULL;
+}
+
+/*
+ * pack_insert - Enter free block bp into the packed copy of list
+ *     listNum, and set *sptr and *iptr to its list neighbours the way
+ *     insert_node's walk would. Returns 0 if the list is (or just got)
+ *     spilled, so that insert_node walks it instead.
+ */
+static int pack_insert(int listNum, void *bp, size_t size, void **sptr, void **iptr){
+
+  unsigned off = (char *)bp - heap_lo;
+  int n = pack_n[listNum];
+  int k;
+
+  if (pack_spilled[listNum])
+  {
+	pack_len[listNum]++;
+	return 0;
+  }
+  if (n == PACK_MAX)
+  {
+	pack_spilled[listNum] = 1;
+	pack_len[listNum] = n + 1;
+	return 0;
+  }
+
+  if (fit_policy == MM_FIT_ADDRESS)
+	k = pack_first(pack_off[listNum], n, off);
+  else
+	k = pack_first(pack_size[listNum], n, size);
+  *sptr = (k < n) ? heap_lo + pack_off[listNum][k] : NULL;
+  *iptr = (k > 0) ? heap_lo + pack_off[listNum][k - 1] : NULL;
+
+  memmove(&pack_size[listNum][k + 1], &pack_size[listNum][k], (n - k) * sizeof(unsigned));
+  memmove(&pack_off[listNum][k + 1], &pack_off[listNum][k], (n - k) * sizeof(unsigned));
+  pack_size[listNum][k] = size;
+  pack_off[listNum][k] = off;
+  pack_n[listNum] = n + 1;
+  return 1;
+}
+
+/*
+ * pack_delete - Remove block bp, just unlinked, from the packed copy
+ *     of list listNum. A spilled list is packed again once it is down
+ *     to PACK_LOW blocks.
+ */
+static void pack_delete(int listNum, void *bp){
+
+  unsigned off = (char *)bp - heap_lo;
+  int n = pack_n[listNum];
+  int k;
+
+  if (pack_spilled[listNum])
+  {
+	if (--pack_len[listNum] <= PACK_LOW)
+	  pack_list(listNum);
+	return;
+  }
+
+  /* Equal sizes are adjacent, so the block is among the first that fit */
+  if (fit_policy == MM_FIT_ADDRESS)
+	k = pack_first(pack_off[listNum], n, off);
+  else
+	for (k = pack_first(pack_size[listNum], n, GET_SIZE(HDRP(bp)));
+		 pack_off[listNum][k] != off; k++)
+	  ;
+
+  memmove(&pack_size[listNum][k], &pack_size[listNum][k + 1], (n - k - 1) * sizeof(unsigned));
+  memmove(&pack_off[listNum][k], &pack_off[listNum][k + 1], (n - k - 1) * sizeof(unsigned));
+  pack_n[listNum] = n - 1;
+}
+
+/*
+ * pack_list - Make the packed copy of list listNum from its links,
+ *     or mark it spilled, with its length, if it is too long
+ */
+static void pack_list(int listNum){
+
+  char *bp;
+  int n = 0;
+
+  for (bp = HEAD(listNum); bp != NULL; bp = PRED(bp))
+  {
+	if (n < PACK_MAX)
+	{
+	  pack_size[listNum][n] = GET_SIZE(HDRP(bp));
+	  pack_off[listNum][n] = bp - heap_lo;
+	}
+	n++;
+  }
+  pack_spilled[listNum] = (n > PACK_MAX);
+  pack_len[listNum] = n;
+  pack_n[listNum] = MIN(n, PACK_MAX);
+}
+
+/*
+ * pack_rebuild - Make the packed lists from the segregated lists of a
+ *     heap that mm_attach found
+ */
+static void pack_rebuild(void){
+
+  int listNum;
+
+  for (listNum = 0; listNum < LISTS; listNum++)
+	pack_list(listNum);
+}
+#endif
+
+/*
+ * mm_region_create - Make an empty region. Its first chunk is only
+ *     taken by the first allocation.
+ */
+mm_region_t *mm_region_create(void){
+
+  mm_region_t *region;
+
+  if ((region = mm_malloc(sizeof(mm_region_t))) == NULL)
+    return NULL;
+  region->cur = region->end = NULL;
+  region->chunks = NULL;
+  return region;
+}
+
+/*
+ * mm_region_alloc - Allocate size bytes in region by bumping a pointer,
+ *     starting a new chunk when the current one is full
+ */
+void *mm_region_alloc(mm_region_t *region, size_t size){
+
+  size_t csize;
+  chunk_t *chunk;
+  char *bp;
+
+  /* Too big to round up and put behind a chunk header */
+  if (size == 0 || size > SIZE_MAX - sizeof(chunk_t) - DSIZE)
+    return NULL;
+  size = (size + DSIZE - 1) & ~(size_t)(DSIZE - 1);
+
+  if (size > (size_t)(region->end - region->cur))
+  {
+	csize = MAX(REGION_CHUNK, size + sizeof(chunk_t));
+	if ((chunk = mm_malloc(csize)) == NULL)
+	  return NULL;
+	chunk->next = region->chunks;
+	region->chunks = chunk;
+	region->cur = (char *)(chunk + 1);
+	region->end = (char *)chunk + csize;
+  }
+
+  bp = region->cur;
+  region->cur += size;
+  return bp;
+}
+
+/*
+ * mm_region_reset - Free every object in region at once: all chunks but
+ *     the oldest go back to the free lists, and allocation starts over
+ *     at the beginning of the oldest
+ */
+void mm_region_reset(mm_region_t *region){
+
+  chunk_t *chunk;
+
+  if (region->chunks == NULL)
+    return;
+  while ((chunk = region->chunks)->next != NULL)
+  {
+	region->chunks = chunk->next;
+	mm_free(chunk);
+  }
+  region->cur = (char *)(chunk + 1);
+  region->end = (char *)chunk + mm_usable_size(chunk);
+}
+
+/*
+ * mm_region_destroy - Free every chunk of region, and region itself
+ */
+void mm_region_destroy(mm_region_t *region){
+
+  chunk_t *chunk;
+
+  while ((chunk = region->chunks) != NULL)
+  {
+	region->chunks = chunk->next;
+	mm_free(chunk);
+  }
+  mm_free(region);
+}
+
+/*
+ * mm_pool_create - Make an empty pool of obj_size byte objects
+ */
+mm_pool_t *mm_pool_create(size_t obj_size, size_t align){
+
+  mm_pool_t *pool;
+
+  if (align == 0)
+    align = DSIZE;
+  if (obj_size == 0 || (align & (align - 1)) != 0)
+    return NULL;
+  align = MAX(align, sizeof(char *));   /* a free slot holds a link */
+
+  pthread_mutex_lock(&pool_lock);
+  if ((pool = mm_malloc(sizeof(mm_pool_t))) != NULL)
+    pool->id = ++pool_ids;
+  pthread_mutex_unlock(&pool_lock);
+  if (pool == NULL)
+    return NULL;
+  pool->slot = (MAX(obj_size, sizeof(char *)) + align - 1) & ~(align - 1);
+  pool->align = align;
+  pool->free = pool->cur = pool->end = NULL;
+  pool->chunks = NULL;
+  pool->parent = 0;
+  pool->local_next = NULL;
+  return pool;
+}
+
+/*
+ * mm_pool_local - Return the calling thread's pool for pool's objects,
+ *     creating it on first use. Only this thread may use it, and it
+ *     should destroy it before it exits. Per-thread pools are found by
+ *     pool's id, so one left behind by a destroyed pool is never taken
+ *     for a new pool at the same address.
+ */
+mm_pool_t *mm_pool_local(mm_pool_t *pool){
+
+  mm_pool_t *local;
+
+  for (local = local_pools; local != NULL; local = local->local_next)
+	if (local->parent == pool->id)
+	  return local;
+
+  if ((local = mm_pool_create(pool->slot, pool->align)) == NULL)
+	return NULL;
+  local->parent = pool->id;
+  local->local_next = local_pools;
+  local_pools = local;
+  return local;
+}
+
+/*
+ * mm_pool_alloc - Take a slot from pool: the last one freed, else the
+ *     next never used one, else one from a new chunk
+ */
+void *mm_pool_alloc(mm_pool_t *pool){
+
+  size_t csize;
+  chunk_t *chunk;
+  char *bp;
+
+  if ((bp = pool->free) != NULL)
+  {
+	pool->free = *(char **)bp;
+	return bp;
+  }
+
+  if (pool->slot > (size_t)(pool->end - pool->cur))
+  {
+	csize = MAX(POOL_CHUNK, sizeof(chunk_t) + pool->align + pool->slot);
+	pthread_mutex_lock(&pool_lock);
+	chunk = mm_malloc(csize);
+	pthread_mutex_unlock(&pool_lock);
+	if (chunk == NULL)
+	  return NULL;
+	chunk->next = pool->chunks;
+	pool->chunks = chunk;
+	pool->cur = (char *)(((size_t)(chunk + 1) + pool->align - 1) & ~(pool->align - 1));
+	pool->end = (char *)chunk + csize;
+  }
+
+  bp = pool->cur;
+  pool->cur += pool->slot;
+  return bp;
+}
+
+/*
+ * mm_pool_free - Give slot ptr back to pool, which it came from
+ */
+void mm_pool_free(mm_pool_t *pool, void *ptr){
+
+  if (ptr == NULL)
+    return;
+  *(char **)ptr = pool->free;
+  pool->free = ptr;
+}
+
+/*
+ * mm_pool_destroy - Free every chunk of pool, and pool itself. A
+ *     per-thread pool is destroyed by the thread that owns it.
+ */
+void mm_pool_destroy(mm_pool_t *pool){
+
+  mm_pool_t **pp;
+  chunk_t *chunk;
+
+  if (pool->parent != 0)
+  {
+	for (pp = &local_pools; *pp != pool; pp = &(*pp)->local_next)
+	  ;
+	*pp = pool->local_next;
+  }
+  pthread_mutex_lock(&pool_lock);
+  while ((chunk = pool->chunks) != NULL)
+  {
+	pool->chunks = chunk->next;
+	mm_free(chunk);
+  }
+  mm_free(pool);
+  pthread_mutex_unlock(&pool_lock);
+}
+
+/*
+ * mm_set_bibop - Serve small requests from runs, from the next mm_init
+ */
+void mm_set_bibop(int on){
+
+  bibop = on;
+}
+
+/*
+ * bibop_init - Start with no runs. Called by mm_init.
+ */
+static void bibop_init(void){
+
+  int cls, i;
+
+  memset(runs, 0, sizeof(runs));
+  memset(partial, 0, sizeof(partial));
+  empty_runs = NULL;
+  nempty = 0;
+
+  for (i = 0, cls = 0; i <= BIBOP_MAX / 16; i++) {
+    while (class_size[cls] < i * 16)
+      cls++;
+    size_class[i] = cls;
+  }
+}
+
+/*
+ * bibop_malloc - Take an object of class cls from the first run of the
+ *     class that has one free, reusing freed objects before untouched ones
+ */
+static void *bibop_malloc(int cls){
+
+  run_t *r = partial[cls];
+  char *bp;
+
+  if (r == NULL && (r = new_run(cls)) == NULL)
+    return NULL;
+
+  if (r->free != NULL) {
+    bp = r->free;
+    r->free = *(char **)bp;
+  } else {
+    bp = r->tail;
+    r->tail += class_size[cls];
+  }
+
+  if (--r->nfree == 0)
+    unlink_run(r);
+  return bp;
+}
+
+/*
+ * bibop_free - Push object bp back onto run r. A run that empties is
+ *     kept for reuse by any class, or given back to the heap.
+ */
+static void bibop_free(run_t *r, void *bp){
+
+  int cls = r->cls - 1;
+  char *base;
+
+  *(char **)bp = r->free;
+  r->free = bp;
+  if (r->nfree++ == 0)
+    link_run(r);
+  if (r->nfree < RUN_SIZE / class_size[cls])
+    return;
+
+  unlink_run(r);
+  r->cls = 0;
+  if (nempty < EMPTY_KEPT) {
+    r->next = empty_runs;
+    empty_runs = r;
+    nempty++;
+  } else {
+    base = heap_lo + ((size_t)(r - runs) << RUN_BITS);
+    mm_free(base);  /* an ordinary block now that r->cls is 0 */
+  }
+}
+
+/*
+ * new_run - Set up an empty run for class cls
+ */
+static run_t *new_run(int cls){
+
+  run_t *r;
+  char *base;
+
+  if (empty_runs != NULL) {
+    r = empty_runs;
+    empty_runs = r->next;
+    nempty--;
+    base = heap_lo + ((size_t)(r - runs) << RUN_BITS);
+  } else {
+    if ((base = alloc_run()) == NULL)
+      return NULL;
+    r = &runs[RUN_INDEX(base)];
+  }
+
+  r->cls = cls + 1;
+  r->nfree = RUN_SIZE / class_size[cls];
+  r->free = NULL;
+  r->tail = base;
+  link_run(r);
+  return r;
+}
+
+/*
+ * alloc_run - Return an allocated block whose payload is a RUN_SIZE-
+ *     aligned run, carved out of a free block if one is big enough or
+ *     else added to the end of the heap. The gap up to the alignment
+ *     boundary, if any, becomes a free block.
+ */
+static char *alloc_run(void){
+
+  char *bp;
+  char *gapp = NULL;
+  size_t gap;
+
+  if ((bp = carve_run()) != NULL)
+    return bp;
+  bp = (char *)mem_heap_hi() + 1;  /* the block at the epilogue */
+
+  gap = (RUN_SIZE - ((size_t)(bp - heap_lo) & (RUN_SIZE - 1))) & (RUN_SIZE - 1);
+  if (gap > 0 && gap < 2 * DSIZE)
+    gap += RUN_SIZE;
+  if (mem_sbrk(gap + RUN_SIZE + DSIZE) == (void *)-1)
+    return NULL;
+
+  if (gap > 0) {
+    gapp = bp;
+    PUT(HDRP(gapp), PACK(gap, 0));
+    PUT(FTRP(gapp), PACK(gap, 0));
+    bp += gap;
+  }
+  PUT(HDRP(bp), PACK(RUN_SIZE + DSIZE, 1));
+  PUT(FTRP(bp), PACK(RUN_SIZE + DSIZE, 1));
+  PUT(HDRP(NEXT_BLK(bp)), PACK(0, 1));   /* new epilogue header */
+
+  if (gapp != NULL) {
+    insert_node(gapp, gap);
+    coalesce(gapp);
+  }
+  return bp;
+}
+
+/*
+ * carve_run - Split an aligned run out of a free block, leaving free
+ *     blocks (of at least the minimum size) before and after it.
+ *     Returns NULL if no free block can hold one.
+ */
+static char *carve_run(void){
+
+  int listNum;
+  char *bp, *rp, *tp, *end;
+  size_t lead, trail;
+
+  /* Only lists from the class of RUN_SIZE up can hold a run */
+  for (listNum = RUN_BITS; listNum < LISTS; listNum++)
+  {
+	for (bp = HEAD(listNum); bp != NULL; bp = PRED(bp))
+	{
+	  end = bp + GET_SIZE(HDRP(bp));   /* payload of the next block */
+	  rp = heap_lo + (((size_t)(bp - heap_lo) + RUN_SIZE - 1) & ~(size_t)(RUN_SIZE - 1));
+	  if (rp != bp && rp - bp < 2 * DSIZE)
+		rp += RUN_SIZE;
+	  if (rp + RUN_SIZE + DSIZE > end)
+		continue;
+	  trail = end - (rp + RUN_SIZE + DSIZE);
+	  if (trail > 0 && trail < 2 * DSIZE)
+		continue;
+
+	  lead = rp - bp;
+	  delete_node(bp);
+	  if (lead > 0)
+	  {
+		PUT(HDRP(bp), PACK(lead, 0));
+		PUT(FTRP(bp), PACK(lead, 0));
+		insert_node(bp, lead);
+	  }
+	  PUT(HDRP(rp), PACK(RUN_SIZE + DSIZE, 1));
+	  PUT(FTRP(rp), PACK(RUN_SIZE + DSIZE, 1));
+	  if (trail > 0)
+	  {
+		tp = NEXT_BLK(rp);
+		PUT(HDRP(tp), PACK(trail, 0));
+		PUT(FTRP(tp), PACK(trail, 0));
+		insert_node(tp, trail);
+	  }
+	  return rp;
+	}
+  }
+  return NULL;
+}
+
+/* Put run r at the head of the list of runs of its class with free objects */
+static void link_run(run_t *r){
+
+  run_t **head = &partial[r->cls - 1];
+
+  r->prev = NULL;
+  r->next = *head;
+  if (*head != NULL)
+    (*head)->prev = r;
+  *head = r;
+}
+
+/* Take run r off the list of runs of its class with free objects */
+static void unlink_run(run_t *r){
+
+  if (r->prev != NULL)
+    r->prev->next = r->next;
+  else
+    partial[r->cls - 1] = r->next;
+  if (r->next != NULL)
+    r->next->prev = r->prev;
+}
+
 // 
 // 
 // /* 
@@ -3,7 +3,158 @@
 extern int mm_init (void);
 extern void *mm_malloc (size_t size);
 extern void mm_free (void *ptr);
+extern void mm_free_sized(void *ptr, size_t size);
 extern void *mm_realloc(void *ptr, size_t size);
+extern size_t mm_usable_size(void *ptr);
+
+/* Nonzero if mm.c was built with MM_PREFETCH */
+extern const int mm_prefetch;
+
+/*
+ * mm_snapshot saves the heap and the allocator's state, normally right
+ * after mm_init; mm_restore goes back to it, which is a quicker way to
+ * start over than mem_reset_brk and mm_init.
+ */
+extern void mm_snapshot(void);
+extern int mm_restore(void);
+
+/*
+ * Persistent heaps: mm_attach uses a file as the heap, in place of
+ * mem_init and mm_init, and gets back the heap a previous process left
+ * there with mm_detach. A program finds its data again from the root
+ * object. BiBoP runs, regions and pools do not persist.
+ */
+extern int mm_attach(char *path);
+extern void mm_detach(void);
+extern void mm_set_root(void *ptr);
+extern void *mm_root(void);
+
+/*
+ * Fit policies: the order of the blocks in each segregated free list,
+ * which decides which block a first-fit search of the list finds.
+ */
+#define MM_FIT_SIZE    0  /* smallest first, i.e., best fit in the class */
+#define MM_FIT_ADDRESS 1  /* lowest address first */
+
+extern void mm_set_fit(int policy);
+
+/*
+ * Search policies: which fitting block mm_malloc takes from a list.
+ * Good fit looks at no more than budget fitting blocks, and stops at
+ * the first one that is within slack percent of the request.
+ */
+#define MM_SEARCH_FIRST 0  /* the first in list order */
+#define MM_SEARCH_NEXT  1  /* the first after where the last search stopped */
+#define MM_SEARCH_BEST  2  /* the smallest */
+#define MM_SEARCH_GOOD  3  /* the smallest of a bounded search */
+
+extern void mm_set_search(int policy, int budget, int slack);
+
+/*
+ * Split policies: which end of a free block that is split a request
+ * gets. Putting large blocks at the back and small ones at the front
+ * keeps like sizes together, so freeing them leaves large holes.
+ */
+#define MM_SPLIT_FRONT     0  /* always the front */
+#define MM_SPLIT_SIZE      1  /* the back for large requests */
+#define MM_SPLIT_NEIGHBOUR 2  /* the end whose neighbour is closer in size */
+
+extern void mm_set_split(int policy);
+
+/* Serve small requests from size-segregated 64 KB runs (BiBoP) */
+extern void mm_set_bibop(int on);
+
+/*
+ * MM_MALLOC(size) is mm_malloc, except that for a compile-time constant
+ * size the compiler works out the block size, the segregated list and
+ * the BiBoP run class, and the call goes straight to mm_malloc_fixed.
+ * The macros below must agree with adjust_size, list_index and
+ * class_size in mm.c.
+ */
+#define MM_LISTS     20    /* segregated lists */
+#define MM_BIBOP_MAX 2048  /* largest request served from a run */
+
+#define MM_LOG2(x) ((int)(8 * sizeof(unsigned long) - 1) - __builtin_clzl(x))
+#define MM_ASIZE(size) ((size) <= 8 ? 16 : ((size) + 15) / 8 * 8)
+#define MM_LIST(asize) \
+    (MM_LOG2(asize) < MM_LISTS - 1 ? MM_LOG2(asize) : MM_LISTS - 1)
+
+/* Run classes go up by 16 bytes to 128, then in 4 steps per doubling */
+#define MM_RUN_Q(size) (((size) + 15) >> 4)
+#define MM_RUN_CLASS(size) \
+    ((size) > MM_BIBOP_MAX ? 0 : \
+     MM_RUN_Q(size) <= 8 ? (int)MM_RUN_Q(size) - 1 : \
+     4 * MM_LOG2(MM_RUN_Q(size) - 1) - 4 + \
+     (int)((MM_RUN_Q(size) - 1 - (1UL << MM_LOG2(MM_RUN_Q(size) - 1))) >> \
+	   (MM_LOG2(MM_RUN_Q(size) - 1) - 2)))
+
+#define MM_MALLOC(size) \
+    ((__builtin_constant_p(size) && (size) > 0) ? \
+     mm_malloc_fixed((size), MM_ASIZE(size), MM_LIST(MM_ASIZE(size)), \
+		     MM_RUN_CLASS(size)) : \
+     mm_malloc(size))
+
+extern void *mm_malloc_fixed(size_t size, size_t asize, int list, int cls);
+
+/*
+ * Regions: objects that are freed all at once. mm_region_alloc bumps a
+ * pointer through chunks of the mm heap; its objects cannot be passed
+ * to mm_free or mm_realloc. mm_region_reset frees every object in the
+ * region (keeping its first chunk), mm_region_destroy the region too.
+ */
+typedef struct mm_region mm_region_t;
+
+extern mm_region_t *mm_region_create(void);
+extern void *mm_region_alloc(mm_region_t *region, size_t size);
+extern void mm_region_reset(mm_region_t *region);
+extern void mm_region_destroy(mm_region_t *region);
+
+/*
+ * Pools of fixed-size objects: obj_size bytes aligned to align (a power
+ * of 2, or 0 for the usual 8), with no per-object header and no minimum
+ * block size. mm_pool_local returns the calling thread's own pool for
+ * the same objects, whose slots are never shared with other threads.
+ * Threads may use their own pools at the same time, provided nothing
+ * else calls into mm.c meanwhile: the pool functions serialize the
+ * chunks they take from and give back to the heap.
+ */
+typedef struct mm_pool mm_pool_t;
+
+extern mm_pool_t *mm_pool_create(size_t obj_size, size_t align);
+extern mm_pool_t *mm_pool_local(mm_pool_t *pool);
+extern void *mm_pool_alloc(mm_pool_t *pool);
+extern void mm_pool_free(mm_pool_t *pool, void *ptr);
+extern void mm_pool_destroy(mm_pool_t *pool);
+
+/*
+ * A snapshot of the free space in the heap, for the driver's
+ * fragmentation timeline. Free blocks are counted in the segregated
+ * class that would hold them; class i holds blocks of 2^i up to
+ * 2^(i+1)-1 bytes, and the last class holds everything larger.
+ */
+#define MM_MAXCLASSES 32
+
+typedef struct {
+    size_t free_bytes;     /* bytes in free blocks, headers included */
+    size_t largest_free;   /* size of the largest free block */
+    int free_blocks;       /* number of free blocks */
+    int nclasses;          /* entries used in class_bytes[] */
+    size_t class_bytes[MM_MAXCLASSES]; /* free bytes in each class */
+} heapstats_t;
+
+extern void mm_heapstats(heapstats_t *stats);
+
+/*
+ * The bytes of an allocated block that its payload does not use, by
+ * cause, for the driver's fragmentation breakdown (MM_WASTE_STATS)
+ */
+typedef struct {
+    size_t overhead;  /* header and footer */
+    size_t align;     /* rounding the request up to an aligned block size */
+    size_t unsplit;   /* remainder too small for place to split off */
+} blockwaste_t;
+
+extern void mm_blockwaste(void *ptr, size_t size, blockwaste_t *waste);
 
 
 /* 
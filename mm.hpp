@@ -0,0 +1,176 @@
+/*
+ * mm.hpp - C++ adapters for the mm package
+ *
+ * mm::allocator<T> meets the standard Allocator requirements, so any
+ * container can keep its elements in the mm heap:
+ *
+ *     std::map<int, int, std::less<int>,
+ *              mm::allocator<std::pair<const int, int> > > m;
+ *
+ * mm::memory_resource does the same for the std::pmr containers (C++17):
+ *
+ *     std::pmr::vector<int> v(mm::resource());
+ *
+ * Both pass the size back on deallocation (mm_free_sized), and honor
+ * alignments beyond the ALIGNMENT of mm_malloc. As with the C interface,
+ * the heap must have been set up with mem_init and mm_init first, and
+ * mm.c is single threaded: calls must not overlap.
+ */
+#ifndef __MM_HPP_
+#define __MM_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#if __cplusplus >= 201703L
+#include <memory_resource>
+#endif
+
+extern "C" {
+#include "mm.h"
+}
+
+namespace mm {
+
+/* The alignment of every block mm_malloc returns (ALIGNMENT in config.h) */
+const std::size_t heap_align = 8;
+
+/*
+ * allocate_bytes - Allocate size bytes aligned to align, a power of 2.
+ *     Stricter alignments than heap_align over-allocate by align bytes,
+ *     and keep the block pointer in the word in front of the payload.
+ */
+inline void *allocate_bytes(std::size_t size, std::size_t align)
+{
+    char *bp;
+    char *p;
+
+    if (size == 0)
+	size = 1;
+    if (align <= heap_align) {
+	if ((p = static_cast<char *>(mm_malloc(size))) == NULL)
+	    throw std::bad_alloc();
+	return p;
+    }
+
+    if (size + align < size ||
+	(bp = static_cast<char *>(mm_malloc(size + align))) == NULL)
+	throw std::bad_alloc();
+    /* bp is heap_align-aligned, so p >= bp + heap_align leaves room */
+    p = reinterpret_cast<char *>(
+	(reinterpret_cast<std::uintptr_t>(bp) + align) & ~(align - 1));
+    reinterpret_cast<char **>(p)[-1] = bp;
+    return p;
+}
+
+/*
+ * deallocate_bytes - Free p, allocated by allocate_bytes(size, align)
+ */
+inline void deallocate_bytes(void *p, std::size_t size, std::size_t align)
+{
+    if (size == 0)
+	size = 1;
+    if (align <= heap_align)
+	mm_free_sized(p, size);
+    else
+	mm_free_sized(reinterpret_cast<char **>(p)[-1], size + align);
+}
+
+/*
+ * malloc_fixed - MM_MALLOC(Size) for C++: the block size and classes
+ *     are constant expressions, so every call takes the fixed path
+ */
+template <std::size_t Size>
+inline void *malloc_fixed()
+{
+    static_assert(Size > 0, "mm::malloc_fixed of 0 bytes");
+    constexpr std::size_t asize = MM_ASIZE(Size);
+    constexpr int list = MM_LIST(asize);
+    constexpr int cls = MM_RUN_CLASS(Size);
+
+    return mm_malloc_fixed(Size, asize, list, cls);
+}
+
+/*
+ * allocator - Allocator for standard containers. All instances share
+ *     the one mm heap, so they all compare equal.
+ */
+template <class T>
+class allocator {
+public:
+    typedef T value_type;
+
+    allocator() noexcept { }
+    template <class U> allocator(const allocator<U> &) noexcept { }
+
+    T *allocate(std::size_t n)
+    {
+	void *p;
+
+	/* Containers of nodes allocate one element at a time */
+	if (n == 1 && alignof(T) <= heap_align) {
+	    if ((p = malloc_fixed<sizeof(T)>()) == NULL)
+		throw std::bad_alloc();
+	    return static_cast<T *>(p);
+	}
+	if (n > static_cast<std::size_t>(-1) / sizeof(T))
+	    throw std::bad_array_new_length();
+	return static_cast<T *>(allocate_bytes(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *p, std::size_t n) noexcept
+    {
+	deallocate_bytes(p, n * sizeof(T), alignof(T));
+    }
+};
+
+template <class T, class U>
+inline bool operator==(const allocator<T> &, const allocator<U> &) noexcept
+{
+    return true;
+}
+
+template <class T, class U>
+inline bool operator!=(const allocator<T> &, const allocator<U> &) noexcept
+{
+    return false;
+}
+
+#if __cplusplus >= 201703L
+/*
+ * memory_resource - Polymorphic memory resource on the mm heap
+ */
+class memory_resource : public std::pmr::memory_resource {
+protected:
+    void *do_allocate(std::size_t bytes, std::size_t align) override
+    {
+	return allocate_bytes(bytes, align);
+    }
+
+    void do_deallocate(void *p, std::size_t bytes, std::size_t align) override
+    {
+	deallocate_bytes(p, bytes, align);
+    }
+
+    /* Memory from any mm resource can go back to any other */
+    bool do_is_equal(const std::pmr::memory_resource &other) const
+	noexcept override
+    {
+	return dynamic_cast<const memory_resource *>(&other) != NULL;
+    }
+};
+
+/*
+ * resource - Return the mm memory resource
+ */
+inline memory_resource *resource()
+{
+    static memory_resource r;
+    return &r;
+}
+#endif
+
+} /* namespace mm */
+
+#endif /* __MM_HPP_ */
@@ -0,0 +1,224 @@
+/*
+ * mmbench.cc - Standard containers on mm.c versus std::allocator
+ *
+ * Times three container workloads with std::allocator, with
+ * mm::allocator and with std::pmr containers on mm::memory_resource:
+ *
+ *   vector  grow a std::vector<int> one push_back at a time
+ *   map     insert random keys into a std::map, erase half of them,
+ *           and insert them again
+ *   umap    the same with a std::unordered_map
+ *
+ * The timings use the driver's fsecs package, so -c and -C pick the
+ * timer and cache state just as they do for mdriver.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <memory_resource>
+#include <unistd.h>
+
+#include "mm.hpp"
+
+extern "C" {
+#include "memlib.h"
+#include "fsecs.h"
+}
+
+int verbose = 0;        /* -v option, also read by fsecs.c */
+
+/* The workloads */
+enum { VECTOR, MAP, UMAP, NLOADS };
+static const char *load_names[NLOADS] = {"vector", "map", "umap"};
+
+/* The allocators */
+enum { STD, MM, PMR, NALLOCS };
+static const char *alloc_names[NALLOCS] = {
+    "std::allocator", "mm::allocator", "mm::memory_resource"
+};
+
+/* What one fsecs measurement runs */
+typedef struct {
+    int load;
+    int alloc;
+} test_t;
+
+static int nkeys = 20000;    /* elements per container (-n) */
+static std::vector<int> keys; /* random keys, from std::allocator */
+
+/*
+ * Workloads, for any allocator type A. Each builds and destroys its
+ * containers, so the heap is empty again at the end.
+ */
+template <class A, class T>
+using rebind = typename std::allocator_traits<A>::template rebind_alloc<T>;
+
+template <class A>
+static void vector_load(const A &a)
+{
+    int r, i;
+
+    for (r = 0; r < 10; r++) {
+	std::vector<int, rebind<A, int> > v(a);
+	for (i = 0; i < nkeys; i++)
+	    v.push_back(i);
+    }
+}
+
+template <class A>
+static void map_load(const A &a)
+{
+    std::map<int, int, std::less<int>,
+	     rebind<A, std::pair<const int, int> > > m(a);
+    int i;
+
+    for (i = 0; i < nkeys; i++)
+	m[keys[i]] = i;
+    for (i = 0; i < nkeys; i += 2)
+	m.erase(keys[i]);
+    for (i = 0; i < nkeys; i += 2)
+	m[keys[i]] = i;
+}
+
+template <class A>
+static void umap_load(const A &a)
+{
+    std::unordered_map<int, int, std::hash<int>, std::equal_to<int>,
+		       rebind<A, std::pair<const int, int> > > m(0,
+			   std::hash<int>(), std::equal_to<int>(), a);
+    int i;
+
+    for (i = 0; i < nkeys; i++)
+	m[keys[i]] = i;
+    for (i = 0; i < nkeys; i += 2)
+	m.erase(keys[i]);
+    for (i = 0; i < nkeys; i += 2)
+	m[keys[i]] = i;
+}
+
+template <class A>
+static void run_load(int load, const A &a)
+{
+    switch (load) {
+    case VECTOR:
+	vector_load(a);
+	break;
+    case MAP:
+	map_load(a);
+	break;
+    case UMAP:
+	umap_load(a);
+	break;
+    }
+}
+
+/*
+ * run_test - The function that fsecs times: one workload with one
+ *     allocator, starting from a fresh mm heap
+ */
+static void run_test(void *argp)
+{
+    test_t *t = static_cast<test_t *>(argp);
+
+    if (t->alloc == STD) {
+	run_load(t->load, std::allocator<int>());
+	return;
+    }
+
+    mem_reset_brk();
+    if (mm_init() < 0) {
+	fprintf(stderr, "mmbench: mm_init failed\n");
+	exit(1);
+    }
+    if (t->alloc == MM)
+	run_load(t->load, mm::allocator<int>());
+    else
+	run_load(t->load, std::pmr::polymorphic_allocator<int>(mm::resource()));
+}
+
+/*
+ * usage - Explain the command line arguments
+ */
+static void usage(void)
+{
+    fprintf(stderr, "Usage: mmbench [-hv] [-c <timer>] [-C <cache>] [-n <n>]\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-c <timer> Timer: fcyc, tsc, mono, itimer or gettod.\n");
+    fprintf(stderr, "\t-C <cache> Cache state when timing: cold (default), warm or polluted.\n");
+    fprintf(stderr, "\t-h         Print this message.\n");
+    fprintf(stderr, "\t-n <n>     Elements per container (default 20000).\n");
+    fprintf(stderr, "\t-v         Print timer details.\n");
+}
+
+int main(int argc, char **argv)
+{
+    test_t t;
+    double secs[NALLOCS];
+    int c, i;
+
+    while ((c = getopt(argc, argv, "c:C:n:hv")) != EOF) {
+	switch (c) {
+	case 'c': /* Timing method */
+	    if (set_fsecs_timer(optarg) < 0) {
+		usage();
+		exit(1);
+	    }
+	    break;
+	case 'C': /* Cache state for the measurements */
+	    if (set_fsecs_cache(optarg) < 0) {
+		usage();
+		exit(1);
+	    }
+	    break;
+	case 'n': /* Elements per container */
+	    if ((nkeys = atoi(optarg)) < 1) {
+		usage();
+		exit(1);
+	    }
+	    break;
+	case 'v':
+	    verbose = 1;
+	    break;
+	case 'h':
+	    usage();
+	    exit(0);
+	default:
+	    usage();
+	    exit(1);
+	}
+    }
+
+    /* The same random keys for every run */
+    srand(1);
+    for (i = 0; i < nkeys; i++)
+	keys.push_back(rand());
+
+    init_fsecs();
+    mem_init();
+
+    printf("%d elements, %s timer, %s cache (msecs, and vs. std::allocator)\n",
+	   nkeys, fsecs_timer_name(), fsecs_cache_name());
+    printf("%-8s", "");
+    for (t.alloc = 0; t.alloc < NALLOCS; t.alloc++)
+	printf("%22s", alloc_names[t.alloc]);
+    printf("\n");
+
+    for (t.load = 0; t.load < NLOADS; t.load++) {
+	printf("%-8s", load_names[t.load]);
+	for (t.alloc = 0; t.alloc < NALLOCS; t.alloc++) {
+	    secs[t.alloc] = fsecs(run_test, &t);
+	    printf("%14.3f (%4.2fx)", secs[t.alloc] * 1e3,
+		   secs[t.alloc] / secs[STD]);
+	}
+	printf("\n");
+    }
+
+    mem_deinit();
+    exit(0);
+}
@@ -0,0 +1,332 @@
+/*
+ * mmshim.c - LD_PRELOAD shim that runs unmodified programs on mm.c
+ *
+ * Built together with mm.c and memlib.c into libmm.so (see the
+ * Makefile). Running
+ *
+ *     unix> LD_PRELOAD=./libmm.so prog args...
+ *
+ * routes every malloc, free, realloc, calloc, memalign and
+ * malloc_usable_size call made by prog to the mm package.
+ *
+ * Notes:
+ *   - mm.c is single threaded, so every call is serialized by shim_lock.
+ *     The lock is taken across fork() so the child never inherits a
+ *     heap that is halfway through an update.
+ *   - The heap is initialized lazily by the first allocation, which may
+ *     come from the dynamic loader or from dlsym() itself. memlib is
+ *     compiled with MEMLIB_MMAP so that mem_init never calls malloc.
+ *   - Blocks that do not lie in the memlib heap were handed out before
+ *     the shim took over, and are passed on to the libc allocator.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <pthread.h>
+
+#include "mm.h"
+#include "memlib.h"
+#include "config.h"
+
+/*
+ * memalign'ed blocks are carved out of a larger mm block. The word in
+ * front of the aligned payload holds the offset back to the real block,
+ * tagged with bit 1, which is never set in an mm header (sizes are
+ * multiples of 8, and mm.c keeps its own per-block bits in the footer).
+ */
+#define ALIGN_TAG      0x2
+#define TAGP(p)        ((uintptr_t *)(p) - 1)
+#define IS_TAGGED(p)   (*TAGP(p) & ALIGN_TAG)
+#define TAG_OFFSET(p)  (*TAGP(p) & ~(uintptr_t)(ALIGNMENT - 1))
+
+static pthread_mutex_t shim_lock = PTHREAD_MUTEX_INITIALIZER;
+static int shim_ready = 0;  /* set once mem_init and mm_init have run */
+
+/* The libc allocator, for blocks we did not hand out */
+static void (*libc_free)(void *);
+static size_t (*libc_usable_size)(void *);
+
+/* Function prototypes for internal helper routines */
+static void shim_init(void);
+static int shim_owns(void *ptr);
+static void *shim_base(void *ptr);
+static size_t shim_usable_size(void *ptr);
+static void *shim_memalign(size_t alignment, size_t size);
+static void *libc_sym(const char *name);
+static void shim_prepare(void);
+static void shim_parent(void);
+static void shim_child(void);
+
+/*
+ * shim_constructor - Look up libc's entry points and register the fork
+ *     handlers before main runs. dlsym may allocate, which is fine: the
+ *     lock is not held here, so those allocations just come from mm.
+ */
+static void __attribute__((constructor)) shim_constructor(void)
+{
+    libc_free = libc_sym("free");
+    libc_usable_size = libc_sym("malloc_usable_size");
+    pthread_atfork(shim_prepare, shim_parent, shim_child);
+}
+
+/***********************************
+ * The interposed malloc interface
+ ***********************************/
+
+void *malloc(size_t size)
+{
+    void *p;
+
+    /* mm_malloc treats 0 as an error; programs expect a unique pointer */
+    if (size == 0)
+	size = 1;
+    if (size > MAX_HEAP) {
+	errno = ENOMEM;
+	return NULL;
+    }
+
+    pthread_mutex_lock(&shim_lock);
+    if (!shim_ready)
+	shim_init();
+    p = mm_malloc(size);
+    pthread_mutex_unlock(&shim_lock);
+
+    if (p == NULL)
+	errno = ENOMEM;
+    return p;
+}
+
+void free(void *ptr)
+{
+    if (ptr == NULL)
+	return;
+
+    pthread_mutex_lock(&shim_lock);
+    if (shim_owns(ptr)) {
+	mm_free(shim_base(ptr));
+	pthread_mutex_unlock(&shim_lock);
+	return;
+    }
+    pthread_mutex_unlock(&shim_lock);
+
+    /* Allocated before interposition: let libc have it back */
+    if (libc_free == NULL)
+	libc_free = libc_sym("free");
+    libc_free(ptr);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    void *newp;
+    size_t oldsize;
+
+    if (ptr == NULL)
+	return malloc(size);
+    if (size == 0) {
+	free(ptr);
+	return NULL;
+    }
+    if (size > MAX_HEAP) {
+	errno = ENOMEM;
+	return NULL;
+    }
+
+    pthread_mutex_lock(&shim_lock);
+    if (shim_owns(ptr) && !IS_TAGGED(ptr)) {
+	newp = mm_realloc(ptr, size);
+	pthread_mutex_unlock(&shim_lock);
+	if (newp == NULL)
+	    errno = ENOMEM;
+	return newp;
+    }
+    oldsize = shim_owns(ptr) ? shim_usable_size(ptr) : 0;
+    pthread_mutex_unlock(&shim_lock);
+
+    /*
+     * memalign'ed and foreign blocks cannot be resized in place, so
+     * move them into a fresh mm block.
+     */
+    if (oldsize == 0) {
+	if (libc_usable_size == NULL)
+	    libc_usable_size = libc_sym("malloc_usable_size");
+	oldsize = libc_usable_size(ptr);
+    }
+    if ((newp = malloc(size)) == NULL)
+	return NULL;
+    memcpy(newp, ptr, (size < oldsize) ? size : oldsize);
+    free(ptr);
+    return newp;
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    void *p;
+
+    if (size != 0 && nmemb > SIZE_MAX / size) {
+	errno = ENOMEM;
+	return NULL;
+    }
+    if ((p = malloc(nmemb * size)) != NULL)
+	memset(p, 0, nmemb * size);
+    return p;
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    if (alignment == 0 || (alignment & (alignment - 1))) {
+	errno = EINVAL;
+	return NULL;
+    }
+    return shim_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    return memalign(alignment, size);
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    void *p;
+
+    if (alignment < sizeof(void *) || (alignment & (alignment - 1)))
+	return EINVAL;
+    if ((p = shim_memalign(alignment, size)) == NULL)
+	return ENOMEM;
+    *memptr = p;
+    return 0;
+}
+
+size_t malloc_usable_size(void *ptr)
+{
+    size_t size;
+
+    if (ptr == NULL)
+	return 0;
+
+    pthread_mutex_lock(&shim_lock);
+    if (shim_owns(ptr)) {
+	size = shim_usable_size(ptr);
+	pthread_mutex_unlock(&shim_lock);
+	return size;
+    }
+    pthread_mutex_unlock(&shim_lock);
+
+    if (libc_usable_size == NULL)
+	libc_usable_size = libc_sym("malloc_usable_size");
+    return libc_usable_size(ptr);
+}
+
+/*****************
+ * Helper routines
+ *****************/
+
+/*
+ * shim_init - Create the heap on the first allocation. Called with
+ *     shim_lock held.
+ */
+static void shim_init(void)
+{
+    static const char msg[] = "libmm: mm_init failed\n";
+
+    mem_init();
+    if (mm_init() < 0) {
+	write(STDERR_FILENO, msg, sizeof(msg) - 1);
+	abort();
+    }
+    shim_ready = 1;
+}
+
+/*
+ * shim_owns - Does ptr lie in the memlib heap? Called with shim_lock held.
+ */
+static int shim_owns(void *ptr)
+{
+    return shim_ready &&
+	(char *)ptr >= (char *)mem_heap_lo() &&
+	(char *)ptr <= (char *)mem_heap_hi();
+}
+
+/*
+ * shim_base - Map a (possibly memalign'ed) payload back to its mm block
+ */
+static void *shim_base(void *ptr)
+{
+    if (IS_TAGGED(ptr))
+	return (char *)ptr - TAG_OFFSET(ptr);
+    return ptr;
+}
+
+/*
+ * shim_usable_size - Payload bytes available at ptr, which the shim owns
+ */
+static size_t shim_usable_size(void *ptr)
+{
+    void *bp = shim_base(ptr);
+
+    return mm_usable_size(bp) - ((char *)ptr - (char *)bp);
+}
+
+/*
+ * shim_memalign - Allocate size bytes aligned to alignment, a power of 2.
+ *     mm_malloc already returns ALIGNMENT-aligned blocks; anything
+ *     stricter over-allocates by alignment bytes and tags the offset.
+ */
+static void *shim_memalign(size_t alignment, size_t size)
+{
+    char *bp;
+    char *p;
+
+    if (alignment <= ALIGNMENT)
+	return malloc(size);
+    if (size > MAX_HEAP || alignment > MAX_HEAP) {
+	errno = ENOMEM;
+	return NULL;
+    }
+    if ((bp = malloc(size + alignment)) == NULL)
+	return NULL;
+
+    /* bp is ALIGNMENT-aligned, so p >= bp + ALIGNMENT leaves room for the tag */
+    p = (char *)(((uintptr_t)bp + alignment) & ~(uintptr_t)(alignment - 1));
+    *TAGP(p) = (uintptr_t)(p - bp) | ALIGN_TAG;
+    return p;
+}
+
+/*
+ * libc_sym - Find the next definition of name, i.e., the libc one
+ */
+static void *libc_sym(const char *name)
+{
+    static const char msg[] = "libmm: cannot find libc allocator\n";
+    void *fn;
+
+    if ((fn = dlsym(RTLD_NEXT, name)) == NULL) {
+	write(STDERR_FILENO, msg, sizeof(msg) - 1);
+	abort();
+    }
+    return fn;
+}
+
+/*
+ * Fork handlers - hold the lock across fork so the child's copy of the
+ *     heap is consistent, then give each process its own unlocked lock.
+ */
+static void shim_prepare(void)
+{
+    pthread_mutex_lock(&shim_lock);
+}
+
+static void shim_parent(void)
+{
+    pthread_mutex_unlock(&shim_lock);
+}
+
+static void shim_child(void)
+{
+    pthread_mutex_init(&shim_lock, NULL);
+}
@@ -0,0 +1,180 @@
+/*
+ * perfctr.c - Hardware performance counters (Linux perf_event_open)
+ *
+ * Only user-mode events of this process are counted, which works at
+ * the default perf_event_paranoid level. Events the CPU or kernel do
+ * not support are simply left out of the group; if even the cycle
+ * counter cannot be opened (no PMU, e.g. in many VMs, or counting
+ * disallowed), perf_init returns 0 and everything else is a no-op.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "perfctr.h"
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+/* Cache event config: cache id | op << 8 | result << 16 */
+#define CACHE_EVENT(cache, op, result) \
+    ((cache) | ((op) << 8) | ((result) << 16))
+
+static struct {
+    char *name;
+    __u32 type;
+    __u64 config;
+} events[PERF_NEVENTS] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"insns", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"L1D-miss", PERF_TYPE_HW_CACHE,
+     CACHE_EVENT(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+		 PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {"LLC-miss", PERF_TYPE_HW_CACHE,
+     CACHE_EVENT(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ,
+		 PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {"dTLB-miss", PERF_TYPE_HW_CACHE,
+     CACHE_EVENT(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ,
+		 PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {"br-miss", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+static int leader_fd = -1;          /* fd of the group leader (cycles) */
+static int nopen = 0;               /* number of events in the group */
+static int slot[PERF_NEVENTS];      /* position of each event in the group, or -1 */
+static int fds[PERF_NEVENTS] = {-1, -1, -1, -1, -1, -1}; /* fd of each event */
+static double totals[PERF_NEVENTS]; /* counts accumulated since perf_clear */
+
+/*
+ * open_event - Open event i as a member of the group (or as its leader)
+ */
+static int open_event(int i)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = events[i].type;
+    attr.config = events[i].config;
+    attr.disabled = (leader_fd == -1);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP |
+	PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return syscall(__NR_perf_event_open, &attr, 0, -1, leader_fd, 0);
+}
+
+/*
+ * perf_init - Open the counter group; returns the number of events available
+ */
+int perf_init(void)
+{
+    int i, fd;
+
+    /* Start over, e.g., in a child that inherited its parent's group */
+    for (i = 0; i < PERF_NEVENTS; i++) {
+	if (fds[i] >= 0)
+	    close(fds[i]);
+	fds[i] = -1;
+	slot[i] = -1;
+    }
+    leader_fd = -1;
+    nopen = 0;
+
+    for (i = 0; i < PERF_NEVENTS; i++) {
+	if ((fd = open_event(i)) < 0) {
+	    if (i == PERF_CYCLES)
+		return 0;
+	    continue;
+	}
+	if (i == PERF_CYCLES)
+	    leader_fd = fd;
+	fds[i] = fd;
+	slot[i] = nopen++;
+    }
+    perf_clear();
+    return nopen;
+}
+
+/*
+ * perf_clear - Zero the accumulated counts
+ */
+void perf_clear(void)
+{
+    memset(totals, 0, sizeof(totals));
+}
+
+/*
+ * perf_start - Start counting
+ */
+void perf_start(void)
+{
+    if (leader_fd < 0)
+	return;
+    ioctl(leader_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+/*
+ * perf_stop - Stop counting and add the counts to the totals
+ */
+void perf_stop(void)
+{
+    struct {
+	__u64 nr;
+	__u64 time_enabled;
+	__u64 time_running;
+	__u64 values[PERF_NEVENTS];
+    } buf;
+    double scale;
+    int i;
+
+    if (leader_fd < 0)
+	return;
+    ioctl(leader_fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    if (read(leader_fd, &buf, sizeof(buf)) < 0 || buf.time_running == 0)
+	return;
+
+    /* Scale up if the group was only on the PMU part of the time */
+    scale = (double)buf.time_enabled / buf.time_running;
+    for (i = 0; i < PERF_NEVENTS; i++)
+	if (slot[i] >= 0)
+	    totals[i] += buf.values[slot[i]] * scale;
+}
+
+/*
+ * perf_count - Return the count for event, or -1 if it is unavailable
+ */
+double perf_count(int event)
+{
+    return (slot[event] >= 0) ? totals[event] : -1;
+}
+
+/*
+ * perf_name - Return the short name of event
+ */
+char *perf_name(int event)
+{
+    return events[event].name;
+}
+
+#else /* !__linux__ */
+
+/* No perf_event_open: no counters are ever available */
+int perf_init(void) { return 0; }
+void perf_clear(void) { }
+void perf_start(void) { }
+void perf_stop(void) { }
+double perf_count(int event) { return -1; }
+
+char *perf_name(int event)
+{
+    static char *names[PERF_NEVENTS] = {
+	"cycles", "insns", "L1D-miss", "LLC-miss", "dTLB-miss", "br-miss"
+    };
+    return names[event];
+}
+
+#endif /* __linux__ */
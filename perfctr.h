@@ -0,0 +1,37 @@
+/*
+ * perfctr.h - Hardware performance counters (Linux perf_event_open)
+ *
+ * The counters are opened as one group, so they all cover exactly the
+ * same instructions. perf_start/perf_stop bracket the code to measure;
+ * the counts accumulate until perf_clear.
+ */
+
+/* The events we count, in group order (cycles leads the group) */
+enum {
+    PERF_CYCLES,
+    PERF_INSNS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_DTLB_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_NEVENTS
+};
+
+/* Open the counter group; returns the number of events available */
+int perf_init(void);
+
+/* Zero the accumulated counts */
+void perf_clear(void);
+
+/* Start and stop counting */
+void perf_start(void);
+void perf_stop(void);
+
+/*
+ * Return the count accumulated for event since perf_clear, scaled up if
+ * the kernel had to multiplex the group, or -1 if it is unavailable
+ */
+double perf_count(int event);
+
+/* Return the short name of event */
+char *perf_name(int event);
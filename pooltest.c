@@ -0,0 +1,135 @@
+/*
+ * pooltest.c - Check the fixed-size object pools of mm.c
+ *
+ *     unix> make pooltest
+ *
+ * Churns slots through pools of several sizes and alignments, uses
+ * per-thread pools from several threads at once, and destroys and
+ * recreates pools. It exits with status 1, after saying which check
+ * failed, if anything goes wrong.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "mm.h"
+#include "memlib.h"
+
+#define NSLOTS   4000  /* slots live at once in each churn */
+#define NTHREADS 4
+
+static void fail(char *what, int i)
+{
+    fprintf(stderr, "pooltest: %s (%d)\n", what, i);
+    exit(1);
+}
+
+/*
+ * churn - Take and give back slots of size bytes from pool, checking
+ *     that each is aligned and that no two of them overlap
+ */
+static void churn(mm_pool_t *pool, size_t size, size_t align, int seed)
+{
+    static __thread unsigned char *slot[NSLOTS];
+    unsigned r = seed;
+    int i, k, round;
+
+    for (i = 0; i < NSLOTS; i++)
+	slot[i] = NULL;
+    for (round = 0; round < 4 * NSLOTS; round++) {
+	r = r * 1103515245 + 12345;
+	i = (r >> 8) % NSLOTS;
+	if (slot[i] != NULL) {
+	    for (k = 0; k < size; k++)
+		if (slot[i][k] != (unsigned char)(i + seed))
+		    fail("slot overwritten", i);
+	    mm_pool_free(pool, slot[i]);
+	    slot[i] = NULL;
+	    continue;
+	}
+	if ((slot[i] = mm_pool_alloc(pool)) == NULL)
+	    fail("mm_pool_alloc failed", i);
+	if ((uintptr_t)slot[i] % align != 0)
+	    fail("slot misaligned", i);
+	memset(slot[i], i + seed, size);
+    }
+    for (i = 0; i < NSLOTS; i++)
+	mm_pool_free(pool, slot[i]);
+}
+
+/*
+ * thread - Churn the thread's own pool for the shared pool's objects
+ */
+static void *thread(void *vargp)
+{
+    mm_pool_t *shared = vargp;
+    mm_pool_t *local;
+    int seed = (int)(uintptr_t)pthread_self();
+
+    if ((local = mm_pool_local(shared)) == NULL || local == shared)
+	fail("mm_pool_local failed", 0);
+    if (mm_pool_local(shared) != local)
+	fail("mm_pool_local changed", 0);
+    churn(local, 48, 16, seed);
+    mm_pool_destroy(local);
+    return NULL;
+}
+
+int main(void)
+{
+    static size_t sizes[] = {1, 7, 24, 40, 100, 1000};
+    static size_t aligns[] = {0, 16, 64, 256};
+    pthread_t tid[NTHREADS];
+    mm_pool_t *pool, *local, *stale;
+    char *a, *b;
+    int i, j;
+
+    mem_init();
+    if (mm_init() < 0)
+	fail("mm_init failed", 0);
+
+    /* Every size with every alignment */
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	for (j = 0; j < sizeof(aligns) / sizeof(aligns[0]); j++) {
+	    if ((pool = mm_pool_create(sizes[i], aligns[j])) == NULL)
+		fail("mm_pool_create failed", i);
+	    churn(pool, sizes[i], aligns[j] ? aligns[j] : 8, i + j);
+	    mm_pool_destroy(pool);
+	}
+
+    /* Per-thread pools, all at once */
+    if ((pool = mm_pool_create(48, 16)) == NULL)
+	fail("mm_pool_create failed", 0);
+    for (i = 0; i < NTHREADS; i++)
+	if (pthread_create(&tid[i], NULL, thread, pool) != 0)
+	    fail("pthread_create failed", i);
+    for (i = 0; i < NTHREADS; i++)
+	pthread_join(tid[i], NULL);
+    mm_pool_destroy(pool);
+
+    /*
+     * A per-thread pool left behind by a destroyed pool must not be
+     * taken for a new pool, even one at the same address
+     */
+    pool = mm_pool_create(16, 0);
+    stale = mm_pool_local(pool);
+    mm_pool_destroy(pool);
+    if ((pool = mm_pool_create(256, 0)) == NULL ||
+	(local = mm_pool_local(pool)) == NULL)
+	fail("mm_pool_create failed", 0);
+    if (local == stale)
+	fail("stale per-thread pool reused", 0);
+    a = mm_pool_alloc(local);
+    b = mm_pool_alloc(local);
+    if (b - a != 256)
+	fail("per-thread pool has the wrong slot size", (int)(b - a));
+    mm_pool_destroy(stale);
+    mm_pool_destroy(local);
+    mm_pool_destroy(pool);
+
+    mem_deinit();
+    printf("pooltest: OK\n");
+    return 0;
+}
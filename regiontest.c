@@ -0,0 +1,108 @@
+/*
+ * regiontest.c - Check the regions of mm.c
+ *
+ *     unix> make regiontest
+ *
+ * Fills regions across several chunks, resets and destroys them, and
+ * checks that their chunks go back to the free lists. It exits with
+ * status 1, after saying which check failed, if anything goes wrong.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "mm.h"
+#include "memlib.h"
+
+#define NOBJS 2000  /* objects per fill, about a dozen chunks' worth */
+
+static void fail(char *what, int i)
+{
+    fprintf(stderr, "regiontest: %s (%d)\n", what, i);
+    exit(1);
+}
+
+/* The size of object i, with a few bigger than a chunk */
+#define SIZE(i)  ((i) % 500 == 499 ? 40000 : 1 + (i) * 13 % 200)
+
+/*
+ * fill - Allocate NOBJS objects in region, checking that each is
+ *     aligned and that none overlaps another
+ */
+static void fill(mm_region_t *region)
+{
+    static unsigned char *obj[NOBJS];
+    int i, k;
+
+    for (i = 0; i < NOBJS; i++) {
+	if ((obj[i] = mm_region_alloc(region, SIZE(i))) == NULL)
+	    fail("mm_region_alloc failed", i);
+	if ((uintptr_t)obj[i] % 8 != 0)
+	    fail("object misaligned", i);
+	memset(obj[i], i, SIZE(i));
+    }
+    for (i = 0; i < NOBJS; i++)
+	for (k = 0; k < SIZE(i); k++)
+	    if (obj[i][k] != (unsigned char)i)
+		fail("object overwritten", i);
+}
+
+int main(void)
+{
+    mm_region_t *region;
+    heapstats_t before, after;
+    size_t start, heapsize;
+    int i;
+
+    mem_init();
+    if (mm_init() < 0)
+	fail("mm_init failed", 0);
+    mm_heapstats(&before);
+    start = mem_heapsize();
+
+    /* Sizes that would wrap around when rounded up or given a header */
+    if ((region = mm_region_create()) == NULL)
+	fail("mm_region_create failed", 0);
+    if (mm_region_alloc(region, 0) != NULL ||
+	mm_region_alloc(region, SIZE_MAX) != NULL ||
+	mm_region_alloc(region, SIZE_MAX - 8) != NULL ||
+	mm_region_alloc(region, SIZE_MAX - 100) != NULL)
+	fail("huge object allocated", 0);
+
+    /* After the first fill, resets must reuse the chunks */
+    fill(region);
+    mm_region_reset(region);
+    mm_heapstats(&after);
+    if (after.free_bytes <= before.free_bytes)
+	fail("reset freed nothing", (int)after.free_bytes);
+    heapsize = mem_heapsize();
+    for (i = 0; i < 10; i++) {
+	fill(region);
+	mm_region_reset(region);
+    }
+    if (mem_heapsize() != heapsize)
+	fail("reset chunks not reused", (int)mem_heapsize());
+
+    /* Destroying the region must give back everything it took */
+    fill(region);
+    mm_region_destroy(region);
+    mm_heapstats(&after);
+    if (after.free_bytes != before.free_bytes + (mem_heapsize() - start))
+	fail("chunks not freed", (int)after.free_bytes);
+    heapsize = mem_heapsize();
+
+    /* and so must regions made and destroyed over and over */
+    for (i = 0; i < 10; i++) {
+	if ((region = mm_region_create()) == NULL)
+	    fail("mm_region_create failed", i);
+	fill(region);
+	mm_region_destroy(region);
+    }
+    if (mem_heapsize() != heapsize)
+	fail("destroyed chunks not reused", (int)mem_heapsize());
+
+    mem_deinit();
+    printf("regiontest: OK\n");
+    return 0;
+}
@@ -0,0 +1,94 @@
+/*
+ * shimtest.c - Check libmm.so on the calls that mix mm.c's blocks with
+ *     the shim's memalign tags
+ *
+ *     unix> make shimtest
+ *
+ * runs it with LD_PRELOAD=./libmm.so. It exits with status 1, after
+ * saying which check failed, if the heap goes wrong.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <malloc.h>
+
+#define NSMALL 64
+
+/*
+ * check - Fail unless the n bytes at p still hold the pattern for seed
+ */
+static void check(unsigned char *p, size_t n, int seed, char *what)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++)
+	if (p[i] != (unsigned char)(i * 7 + seed)) {
+	    fprintf(stderr, "shimtest: %s: byte %lu changed\n", what,
+		    (unsigned long)i);
+	    exit(1);
+	}
+}
+
+static void fill(unsigned char *p, size_t n, int seed)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++)
+	p[i] = (unsigned char)(i * 7 + seed);
+}
+
+int main(void)
+{
+    unsigned char *p, *q, *small[NSMALL];
+    size_t size = 100;
+    int i;
+
+    /*
+     * Grow a block with small blocks allocated after it, so that most
+     * of the reallocs move it, then free it
+     */
+    if ((p = malloc(size)) == NULL)
+	return 1;
+    fill(p, size, 1);
+    for (i = 0; i < NSMALL; i++) {
+	small[i] = malloc(24);
+	fill(small[i], 24, i);
+	if ((q = realloc(p, size + 300)) == NULL) {
+	    fprintf(stderr, "shimtest: realloc failed\n");
+	    return 1;
+	}
+	check(q, size, 1, "realloc");
+	p = q;
+	fill(p, size + 300, 1);
+	size += 300;
+	if (malloc_usable_size(p) < size) {
+	    fprintf(stderr, "shimtest: usable size %lu < %lu\n",
+		    (unsigned long)malloc_usable_size(p), (unsigned long)size);
+	    return 1;
+	}
+    }
+    free(p);
+
+    /* A memalign'ed block next to them */
+    if ((p = memalign(256, 1000)) == NULL || ((unsigned long)p & 255)) {
+	fprintf(stderr, "shimtest: memalign failed\n");
+	return 1;
+    }
+    fill(p, 1000, 2);
+    if ((q = realloc(p, 5000)) == NULL)
+	return 1;
+    check(q, 1000, 2, "memalign realloc");
+    free(q);
+
+    /* The small blocks must have come through untouched */
+    for (i = 0; i < NSMALL; i++) {
+	check(small[i], 24, i, "small block");
+	free(small[i]);
+    }
+
+    /* The heap must still work after all that */
+    for (i = 0; i < 1000; i++)
+	free(malloc(i * 16 + 1));
+
+    printf("shimtest: OK\n");
+    return 0;
+}